@@ -1,75 +1,306 @@
+#pragma once
+
 #include <vector>
 #include <string>
-#include <fstream>
-#include <map>
-
-typedef std::map<size_t, std::vector<size_t>> student_map; // A student is an id mapping to an array of preferences
-typedef std::map<size_t, size_t> supervisor_map; // A supervisor is an id mapping to a capacity
-
-const student_map parseStudentsCsv(const std::string& csvFilename) {
-    const std::string delimiter = ",";
-    std::ifstream inputFs(csvFilename);
-    std::string lineBuffer, token;
-    size_t loc{0};
-    student_map students;
-
-    while (getline(inputFs, lineBuffer)) {
-        auto pos = 0;
-        size_t id;
-        std::vector<size_t> preferences;
-
-        while ((loc = lineBuffer.find(delimiter)) != std::string::npos) {  
-            token = lineBuffer.substr(1, loc - 2);
-            lineBuffer.erase(0, loc + delimiter.length());
-
-            if (pos == 0) {
-                id = stoi(token.substr(token.find_first_of("0123456789")));
-            } else {
-                preferences.push_back(stoi(token));
+#include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Students in file order, student i has id ids[i] and preferences [offsets[i], offsets[i + 1])
+struct student_table {
+    std::vector<size_t> ids;
+    std::vector<size_t> offsets{0};
+    std::vector<size_t> preferences; // Supervisors as their index in the supervisor table, most preferred first
+
+    size_t size() const { return ids.size(); }
+    const size_t* preferencesBegin(size_t i) const { return preferences.data() + offsets[i]; }
+    const size_t* preferencesEnd(size_t i) const { return preferences.data() + offsets[i + 1]; }
+};
+
+// Supervisors in file order, supervisor i has id ids[i] and takes up to capacities[i] students
+struct supervisor_table {
+    std::vector<size_t> ids;
+    std::vector<size_t> capacities;
+
+    size_t size() const { return ids.size(); }
+};
+
+// Read-only memory mapping of a whole file, unmapped on destruction
+class mapped_file {
+public:
+    explicit mapped_file(const std::string& filename) {
+        const auto fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error(filename + ": cannot open");
+
+        struct stat info{};
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error(filename + ": cannot stat");
+        }
+
+        length = info.st_size;
+        if (length != 0) {
+            const auto mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error(filename + ": cannot map");
             }
+            bytes = static_cast<const char*>(mapped);
+            madvise(const_cast<char*>(bytes), length, MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+    }
+
+    ~mapped_file() {
+        if (bytes != nullptr) munmap(const_cast<char*>(bytes), length);
+    }
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    const char* begin() const { return bytes; }
+    const char* end() const { return bytes + length; }
+
+private:
+    const char* bytes{nullptr};
+    size_t length{0};
+};
+
+// Single pass tokenizer over rows of optionally quoted, comma separated fields
+// Every field is read as an unsigned number of any width, the first field may carry a
+// prefix such as "Student_" before its digits, nothing is allocated per field
+// Malformed rows throw std::runtime_error naming the file and line
+class csv_reader {
+public:
+    csv_reader(const std::string& filename, const char* begin, const char* end) : filename(filename), p(begin), end(end) {}
+
+    // Moves to the next non-empty row, false at the end of the file
+    bool nextRow() {
+        while (p != end && (*p == '\n' || *p == '\r')) {
+            if (*p == '\n') line++;
+            p++;
+        }
+        if (p == end) return false;
 
-            pos++;
+        field = 0;
+        return true;
+    }
+
+    bool atRowEnd() const { return p == end || *p == '\n' || *p == '\r'; }
+
+    // Reads the next field of the current row as a number
+    size_t nextNumber() {
+        if (field != 0) {
+            if (p == end || *p != ',') fail("expected ','");
+            p++;
+        }
+
+        const auto quoted = p != end && *p == '"';
+        if (quoted) p++;
+
+        // Skip a non-numeric prefix in the first field only, e.g. "Student_12"
+        if (field == 0) {
+            while (p != end && *p != '"' && *p != ',' && *p != '\n' && (*p < '0' || *p > '9')) p++;
         }
 
-        token = lineBuffer.substr(1, 1);
-        preferences.push_back(stoi(token));
+        if (p == end || *p < '0' || *p > '9') fail("expected a number in field " + std::to_string(field + 1));
+
+        size_t value{0};
+        while (p != end && *p >= '0' && *p <= '9') {
+            if (value > (SIZE_MAX - 9) / 10) fail("number too large in field " + std::to_string(field + 1));
+            value = value * 10 + (*p - '0');
+            p++;
+        }
+
+        if (quoted) {
+            if (p == end || *p != '"') fail("unterminated or non-numeric field " + std::to_string(field + 1));
+            p++;
+        }
 
-        students[id] = move(preferences);
+        if (!atRowEnd() && *p != ',') fail("unexpected character in field " + std::to_string(field + 1));
+
+        field++;
+        return value;
     }
-    inputFs.close();
 
-    return students;
+    size_t fields() const { return field; }
+
+    size_t lineNumber() const { return line; }
+
+    [[noreturn]] void fail(const std::string& message) const { fail(line, message); }
+
+    [[noreturn]] void fail(size_t atLine, const std::string& message) const {
+        throw std::runtime_error(filename + ":" + std::to_string(atLine) + ": " + message);
+    }
+
+private:
+    const std::string& filename;
+    const char* p;
+    const char* end;
+    size_t line{1}, field{0};
+};
+
+// Fails on the line of a repeated id, idLines is {id, line} per row
+inline void checkIds(const csv_reader& reader, std::vector<std::pair<size_t, size_t>>& idLines, const std::string& kind) {
+    std::sort(idLines.begin(), idLines.end());
+
+    size_t repeat{0}, firstLine{0};
+    for (size_t i = 1; i < idLines.size(); i++) {
+        if (idLines[i].first == idLines[i - 1].first && (repeat == 0 || idLines[i].second < idLines[repeat].second)) {
+            repeat = i;
+            firstLine = idLines[i - 1].second;
+        }
+    }
+    if (repeat != 0) {
+        reader.fail(idLines[repeat].second, "duplicate " + kind + " id " + std::to_string(idLines[repeat].first) +
+                                            ", first on line " + std::to_string(firstLine));
+    }
 }
 
-const supervisor_map parseSupervisorsCsv(const std::string& csvFilename) {
-    const std::string delimiter = ",";
-    std::ifstream inputFs(csvFilename);
-    std::string lineBuffer, token;
-    size_t loc{0};
-    supervisor_map supervisors;
+// Each row is "Student_<id>","<preference 1>",...,"<preference n>"
+// Ids must be unique and every preference must be a supervisor in supervisors, preferences are stored as the
+// supervisor's index in supervisors so ids of any size are fine
+inline const student_table parseStudentsCsv(const std::string& csvFilename, const supervisor_table& supervisors) {
+    const mapped_file file(csvFilename);
+    csv_reader reader(csvFilename, file.begin(), file.end());
+    student_table students;
+    std::vector<std::pair<size_t, size_t>> idLines;
 
-    while (getline(inputFs, lineBuffer)) {
-        auto pos = 0;
-        size_t id;
-        size_t capacity;
+    std::vector<std::pair<size_t, size_t>> supervisorIndex; // {id, index}, sorted by id
+    for (size_t k = 0; k != supervisors.size(); k++) supervisorIndex.push_back({supervisors.ids[k], k});
+    std::sort(supervisorIndex.begin(), supervisorIndex.end());
 
-        while ((loc = lineBuffer.find(delimiter)) != std::string::npos) {  
-            token = lineBuffer.substr(1, loc - 2);
-            lineBuffer.erase(0, loc + delimiter.length());
+    while (reader.nextRow()) {
+        const auto id = reader.nextNumber();
+        students.ids.push_back(id);
+        idLines.push_back({id, reader.lineNumber()});
 
-            if (pos == 0) {
-                id = stoi(token.substr(token.find_first_of("0123456789")));
+        while (!reader.atRowEnd()) {
+            const auto preference = reader.nextNumber();
+            const auto found = std::lower_bound(supervisorIndex.begin(), supervisorIndex.end(), std::make_pair(preference, size_t{0}));
+            if (found == supervisorIndex.end() || found->first != preference) {
+                reader.fail("unknown supervisor " + std::to_string(preference) + " in field " + std::to_string(reader.fields()));
             }
-
-            pos++;
+            students.preferences.push_back(found->second);
         }
 
-        token = lineBuffer.substr(1, 1);
-        capacity = stoi(token);
+        if (reader.fields() < 2) reader.fail("student has no preferences");
+        students.offsets.push_back(students.preferences.size());
+    }
+
+    checkIds(reader, idLines, "student");
+    return students;
+}
+
+// Each row is "Supervisor_<id>","<capacity>", ids must be unique
+inline const supervisor_table parseSupervisorsCsv(const std::string& csvFilename) {
+    const mapped_file file(csvFilename);
+    csv_reader reader(csvFilename, file.begin(), file.end());
+    supervisor_table supervisors;
+    std::vector<std::pair<size_t, size_t>> idLines;
+
+    while (reader.nextRow()) {
+        const auto id = reader.nextNumber();
+        supervisors.ids.push_back(id);
+        supervisors.capacities.push_back(reader.nextNumber());
+        idLines.push_back({id, reader.lineNumber()});
 
-        supervisors[id] = capacity;
+        if (!reader.atRowEnd()) reader.fail("expected 2 fields");
     }
-    inputFs.close();
 
+    checkIds(reader, idLines, "supervisor");
     return supervisors;
-}
\ No newline at end of file
+}
+
+// Dense students x supervisors table of preference scores, built once after parsing
+// A score is how far from the back of the student's preference list the supervisor is, 0 if unlisted,
+// so looking up a student's score is one indexed load instead of a map lookup and a linear find
+// Rows and columns are numbered densely whatever the ids: student i of the students file is row i + 1 and supervisor k
+// of the supervisors file is column k, row 0 is the empty slot and scores 0 everywhere
+// The GA stores rows in its slots, studentIds turns them back into ids for printing
+struct preference_matrix {
+    std::vector<uint32_t> scores; // Row per student, column per supervisor
+    std::vector<size_t> studentIds{0}; // Id of the student in each row, row 0 is the empty slot
+    std::vector<size_t> studentRows; // Rows of the students in the instance, in file order
+    size_t stride{0}; // Number of supervisors
+    size_t studentCount{0};
+
+    uint32_t score(size_t student, size_t supervisor) const {
+        return scores[student * stride + supervisor];
+    }
+
+    const uint32_t* row(size_t student) const {
+        return scores.data() + student * stride;
+    }
+
+    // Row that holds or held student studentId, 0 if they never had one
+    size_t rowOf(size_t studentId) const {
+        const auto found = std::find(studentIds.begin() + 1, studentIds.end(), studentId);
+        return found == studentIds.end() ? 0 : found - studentIds.begin();
+    }
+
+    bool hasStudent(size_t studentId) const {
+        const auto row = rowOf(studentId);
+        return row != 0 && std::find(studentRows.begin(), studentRows.end(), row) != studentRows.end();
+    }
+};
+
+inline const preference_matrix buildPreferenceMatrix(const student_table& students, const supervisor_table& supervisors) {
+    preference_matrix matrix;
+    matrix.stride = supervisors.size();
+    matrix.studentIds.insert(matrix.studentIds.end(), students.ids.begin(), students.ids.end());
+    for (size_t i = 0; i != students.size(); i++) matrix.studentRows.push_back(i + 1);
+    matrix.studentCount = students.size();
+    matrix.scores.assign((students.size() + 1) * matrix.stride, 0);
+
+    for (size_t i = 0; i != students.size(); i++) {
+        const auto first = students.preferencesBegin(i), last = students.preferencesEnd(i);
+        for (auto preference = first; preference != last; preference++) {
+            auto& score = matrix.scores[(i + 1) * matrix.stride + *preference];
+            if (score == 0) score = last - preference; // First listing wins, as std::find would
+        }
+    }
+
+    return matrix;
+}
+
+// Replaces the preferences of student studentId, most preferred first, adding the student if they are new
+// Preferences are supervisor columns and must be below matrix.stride, scores follow buildPreferenceMatrix
+// A new student gets the next row, one who was removed gets their old row back
+inline void setStudentPreferences(preference_matrix& matrix, size_t studentId, const std::vector<size_t>& preferences) {
+    for (const auto supervisor : preferences) {
+        if (supervisor >= matrix.stride) throw std::invalid_argument("unknown supervisor column " + std::to_string(supervisor));
+    }
+
+    auto student = matrix.rowOf(studentId);
+    if (student == 0) {
+        student = matrix.studentIds.size();
+        matrix.scores.resize((student + 1) * matrix.stride, 0);
+        matrix.studentIds.push_back(studentId);
+    }
+    if (std::find(matrix.studentRows.begin(), matrix.studentRows.end(), student) == matrix.studentRows.end()) {
+        matrix.studentRows.push_back(student);
+        matrix.studentCount = matrix.studentRows.size();
+    }
+
+    const auto row = matrix.scores.data() + student * matrix.stride;
+    std::fill(row, row + matrix.stride, 0);
+    for (size_t i = 0; i != preferences.size(); i++) {
+        if (row[preferences[i]] == 0) row[preferences[i]] = preferences.size() - i;
+    }
+}
+
+// Drops student studentId, their row scores 0 from now on like an empty slot and is kept in case they come back
+inline void removeStudent(preference_matrix& matrix, size_t studentId) {
+    const auto student = matrix.rowOf(studentId);
+    const auto found = std::find(matrix.studentRows.begin(), matrix.studentRows.end(), student);
+    if (student == 0 || found == matrix.studentRows.end()) throw std::invalid_argument("unknown student " + std::to_string(studentId));
+
+    matrix.studentRows.erase(found);
+    matrix.studentCount = matrix.studentRows.size();
+    std::fill(matrix.scores.begin() + student * matrix.stride, matrix.scores.begin() + (student + 1) * matrix.stride, 0);
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "a1_csv.h"
+#include "a1_ga.h"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+// Exact solver for the allocation problem, a transportation problem between students and supervisors
+// Students are added one at a time, each along a cheapest augmenting path (successive shortest paths) in the residual
+// graph over supervisors only: moving a student from supervisor a to b costs their score at a minus their score at b,
+// and a path ends at a supervisor with a free slot. Every student costs minus their score, and a student can stay
+// unallocated at an extra node with room for everyone and cost 0, so more students than slots is no special case
+// Dijkstra runs on the supervisors with potentials, the cheapest move between each pair of supervisors comes from a
+// heap per pair that drops students who have since left, so a student costs O(K^2) plus O(K log S) per student moved
+// instead of a search over every student's edges
+class allocation_transport {
+public:
+    allocation_transport(const preference_matrix& preferences, const alloc_layout& layout)
+        : preferences(preferences), layout(layout), nodes(layout.supervisors() + 1), moves(nodes * nodes),
+          potential(nodes + 1, 0), distance(nodes + 1), previous(nodes), mover(nodes), done(nodes + 1),
+          capacity(nodes), load(nodes, 0), where(preferences.studentCount, nodes) {
+        for (size_t k = 0; k != layout.supervisors(); k++) capacity[k] = layout.offsets[k + 1] - layout.offsets[k];
+        capacity[nodes - 1] = preferences.studentCount;
+    }
+
+    // Supervisor index of every student in preferences.studentRows order, layout.supervisors() for unallocated
+    const std::vector<size_t>& solve() {
+        for (size_t student = 0; student != preferences.studentCount; student++) add(student);
+        return where;
+    }
+
+private:
+    typedef std::pair<int64_t, uint32_t> move; // Cost of the move and the index of the student making it
+
+    int64_t cost(size_t student, size_t node) const {
+        if (node == layout.supervisors()) return 0;
+        return -static_cast<int64_t>(preferences.score(preferences.studentRows[student], node));
+    }
+
+    void place(size_t student, size_t node) {
+        where[student] = node;
+        load[node]++;
+        for (size_t b = 0; b != nodes; b++) {
+            if (b == node) continue;
+            auto& heap = moves[node * nodes + b];
+            heap.push_back({cost(student, b) - cost(student, node), static_cast<uint32_t>(student)});
+            std::push_heap(heap.begin(), heap.end(), std::greater<move>());
+        }
+    }
+
+    // Cheapest move of a student still at a over to b, nullptr if there is none
+    const move* cheapestMove(size_t a, size_t b) {
+        auto& heap = moves[a * nodes + b];
+        while (!heap.empty() && where[heap.front().second] != a) {
+            std::pop_heap(heap.begin(), heap.end(), std::greater<move>());
+            heap.pop_back();
+        }
+        return heap.empty() ? nullptr : &heap.front();
+    }
+
+    void add(size_t student) {
+        const auto sink = nodes;
+        const auto infinity = std::numeric_limits<int64_t>::max();
+
+        // The student may enter at any node, distances are shifted so the cheapest entry is 0 and none is negative
+        auto lowest = infinity;
+        for (size_t b = 0; b != nodes; b++) {
+            distance[b] = cost(student, b) - potential[b];
+            lowest = std::min(lowest, distance[b]);
+            previous[b] = nodes;
+        }
+        for (size_t b = 0; b != nodes; b++) distance[b] -= lowest;
+        distance[sink] = infinity;
+        std::fill(done.begin(), done.end(), 0);
+
+        // Dense Dijkstra, it stops as soon as the sink is the closest node left
+        size_t last = nodes;
+        for (;;) {
+            auto a = sink;
+            for (size_t v = 0; v != nodes; v++) {
+                if (!done[v] && distance[v] < distance[a]) a = v;
+            }
+            if (a == sink) break;
+            done[a] = 1;
+
+            if (load[a] < capacity[a] && distance[a] + potential[a] - potential[sink] < distance[sink]) {
+                distance[sink] = distance[a] + potential[a] - potential[sink];
+                last = a;
+            }
+            if (load[a] == 0) continue;
+
+            for (size_t b = 0; b != nodes; b++) {
+                if (done[b]) continue;
+                const auto cheapest = cheapestMove(a, b);
+                if (cheapest == nullptr) continue;
+
+                const auto reduced = distance[a] + cheapest->first + potential[a] - potential[b];
+                if (reduced < distance[b]) {
+                    distance[b] = reduced;
+                    previous[b] = a;
+                    mover[b] = cheapest->second;
+                }
+            }
+        }
+
+        for (size_t v = 0; v <= nodes; v++) potential[v] += std::min(distance[v], distance[sink]);
+
+        // Every student on the path moves one node along it and the new student takes the first
+        auto v = last;
+        for (; previous[v] != nodes; v = previous[v]) {
+            load[previous[v]]--;
+            place(mover[v], v);
+        }
+        place(student, v);
+    }
+
+    const preference_matrix& preferences;
+    const alloc_layout& layout;
+    const size_t nodes; // Supervisors and the unallocated node, the sink is node nodes
+    std::vector<std::vector<move>> moves; // Min-heap per ordered pair of nodes, a * nodes + b
+    std::vector<int64_t> potential, distance;
+    std::vector<size_t> previous;
+    std::vector<uint32_t> mover;
+    std::vector<char> done;
+    std::vector<size_t> capacity, load, where;
+};
+
+// Optimal allocation under the same scoring as calculateFitness, laid out like a GA individual
+// Every student is assigned if capacity allows, spare capacity is left as empty slots (id 0)
+inline const alloc_result solveAllocation(const preference_matrix& preferences, const supervisor_table& supervisors) {
+    const alloc_layout layout(supervisors);
+    allocation_transport transport(preferences, layout);
+    const auto& where = transport.solve();
+
+    alloc_result result;
+    result.best.assign(layout.slots(), 0);
+    std::vector<size_t> nextSlot(layout.offsets.begin(), layout.offsets.end() - 1);
+
+    for (size_t s = 0; s != preferences.studentCount; s++) {
+        if (where[s] != layout.supervisors()) result.best[nextSlot[where[s]]++] = preferences.studentRows[s];
+    }
+
+    // A student left unallocated scores 0 wherever a slot is still free, or a path would have used it, so they fill those
+    size_t k = 0;
+    for (size_t s = 0; s != preferences.studentCount; s++) {
+        if (where[s] != layout.supervisors()) continue;
+        while (k != layout.supervisors() && nextSlot[k] == layout.offsets[k + 1]) k++;
+        if (k == layout.supervisors()) break;
+        result.best[nextSlot[k]++] = preferences.studentRows[s];
+    }
+
+    result.bestFitness = calculateMappingCollectionFitness(preferences, layout, result.best.data());
+
+    return result;
+}
@@ -0,0 +1,664 @@
+#pragma once
+
+#include "a1_csv.h"
+#include "ga_random.h"
+#include "ga_select.h"
+#include "ga_trace.h"
+#include "ga_channel.h"
+#include "ga_stop.h"
+#include "ga_checkpoint.h"
+#include "ga_profile.h"
+#include "ga_adapt.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class migration_topology { ring, complete };
+
+typedef uint32_t student_id; // A student's row in preference_matrix, 0 marks an empty slot and scores 0 for every supervisor
+
+// Run parameters, defaults are the original assignment settings
+// These share a program with ai.h in ga_bench, so they live here rather than as global constants
+struct alloc_config {
+    size_t population{20};
+    double crossoverFraction{0.6};
+    double mutationRate{0.4};
+    size_t generations{10000};
+    trace_format trace{trace_format::text};
+    size_t islands{1}; // Above 1 runs the island model, one thread per island
+    size_t migrationInterval{50}; // Generations between migrations
+    size_t migrants{1}; // Fittest individuals each island sends per migration
+    migration_topology topology{migration_topology::ring};
+    size_t localSearchMoves{0}; // Candidate swaps the memetic local search may score per generation, 0 turns it off
+    size_t localSearchMicros{0}; // Optional wall clock cap on the local search per generation, 0 for none
+    stop_criteria stop;
+    size_t checkpointInterval{0}; // Generations between checkpoints to outputName.ckpt, 0 for none
+    bool resume{false}; // Continue from outputName.ckpt if it exists
+    bool profile{false}; // Write per-phase times and counters to outputName_profile.json, island 0 only
+    bool profileSamples{false}; // Also keep one profile sample per generation
+    std::vector<trace_record>* history{nullptr}; // If set, every generation's trace record is appended here too, island 0 only
+    selection_mode selection{selection_mode::roulette}; // tournament and steady_state do not use crossoverFraction
+    size_t tournamentSize{2};
+    size_t steadyStateOffspring{2}; // Offspring made per generation in steady_state mode
+    bool adaptive{false}; // Adjust mutationRate and crossoverFraction every generation, logged to outputName_rates.txt, island 0 only
+};
+
+// How an individual's student slots are split between supervisors, the same for every individual
+// Supervisor k owns slots [offsets[k], offsets[k + 1]), one slot per unit of capacity
+struct alloc_layout {
+    std::vector<size_t> supervisorIds; // For printing, supervisor k is column k of the preference matrix
+    std::vector<size_t> offsets;
+    std::vector<uint32_t> slotSupervisor; // Supervisor index of every slot, so scoring needs no partition lookup
+
+    explicit alloc_layout(const supervisor_table& supervisors) : supervisorIds(supervisors.ids) {
+        offsets.push_back(0);
+        for (size_t k = 0; k != supervisors.size(); k++) {
+            offsets.push_back(offsets.back() + supervisors.capacities[k]);
+            slotSupervisor.insert(slotSupervisor.end(), supervisors.capacities[k], static_cast<uint32_t>(k));
+        }
+    }
+
+    size_t slots() const { return offsets.back(); }
+    size_t supervisors() const { return supervisorIds.size(); }
+};
+
+// A whole population in one preallocated block, individual i is slots [i * slots, (i + 1) * slots)
+// Two of these are swapped every generation so the GA loop never allocates
+struct alloc_population {
+    size_t slots{0};
+    std::vector<student_id> ids;
+    std::vector<size_t> fitness; // Total fitness of each individual, kept up to date by every operator
+
+    alloc_population(size_t count, size_t slots) : slots(slots), ids(count * slots), fitness(count) {}
+
+    size_t size() const { return fitness.size(); }
+    student_id* individual(size_t i) { return ids.data() + i * slots; }
+    const student_id* individual(size_t i) const { return ids.data() + i * slots; }
+
+    // Copies individual i of from into slot j, storage is reused
+    void copyFrom(const alloc_population& from, size_t i, size_t j) {
+        std::copy(from.individual(i), from.individual(i) + slots, individual(j));
+        fitness[j] = from.fitness[i];
+    }
+};
+
+struct alloc_result {
+    std::vector<student_id> best; // Best individual seen, laid out by alloc_layout
+    size_t bestFitness{0};
+    size_t generations{0};
+    size_t evaluations{0}; // Individuals scored, in full or incrementally
+    double mutationRate{0}, crossoverFraction{0}; // Rates used in the last generation
+};
+
+// Fitness function, higher is better
+const size_t calculateFitness(const preference_matrix& preferences, const alloc_layout& layout, const student_id* individual, size_t supervisor);
+const size_t calculateMappingCollectionFitness(const preference_matrix& preferences, const alloc_layout& layout, const student_id* individual);
+
+// Mutation method is to swap 2 random students belonging to 2 random supervisors
+// Requires 2 random student indices and 2 random supervisor indices
+// Fitness is updated from the scores of the two moved students alone
+inline void swapMutate(const preference_matrix& preferences, const alloc_layout& layout, student_id* individual, size_t& fitness, ga_rng& rng) {
+    const auto supervisor1 = uniformBelow(rng, layout.supervisors()), supervisor2 = uniformBelow(rng, layout.supervisors());
+
+    if (supervisor1 == supervisor2) return;
+
+    const auto begin1 = layout.offsets[supervisor1], end1 = layout.offsets[supervisor1 + 1];
+    const auto begin2 = layout.offsets[supervisor2], end2 = layout.offsets[supervisor2 + 1];
+    if (begin1 == end1 || begin2 == end2) return;
+
+    auto& student1 = individual[begin1 + uniformBelow(rng, end1 - begin1)];
+    auto& student2 = individual[begin2 + uniformBelow(rng, end2 - begin2)];
+
+    fitness += preferences.score(student1, supervisor2) + preferences.score(student2, supervisor1);
+    fitness -= preferences.score(student1, supervisor1) + preferences.score(student2, supervisor2);
+    std::swap(student1, student2);
+}
+
+// Memetic local search, steepest-ascent hill climbing over student swaps
+// Each sweep takes one random student and scores swapping them with every student of another supervisor,
+// then applies the best swap if it improves fitness, every candidate is scored in O(1) from the preference matrix
+// Stops once maxMoves candidates have been scored or deadline passes, returns the number scored
+// A budget too small for a whole sweep scores the candidates in a window of the slots starting at a random one
+inline size_t localSearch(const preference_matrix& preferences, const alloc_layout& layout, student_id* individual, size_t& fitness,
+                          ga_rng& rng, size_t maxMoves, std::chrono::steady_clock::time_point deadline) {
+    const auto slots = layout.slots();
+    size_t moves{0};
+
+    while (slots > 1 && moves < maxMoves && std::chrono::steady_clock::now() < deadline) {
+        const auto span = std::min(slots, maxMoves - moves);
+        const auto first = span == slots ? 0 : uniformBelow(rng, slots);
+        const auto a = uniformBelow(rng, slots);
+        const auto studentA = individual[a];
+        const auto supervisorA = layout.slotSupervisor[a];
+        const auto rowA = preferences.row(studentA);
+        const int64_t currentA = rowA[supervisorA];
+
+        int64_t bestDelta{0};
+        size_t bestSlot{a};
+        for (size_t j = 0; j != span; j++) {
+            const auto b = first + j < slots ? first + j : first + j - slots;
+            const auto supervisorB = layout.slotSupervisor[b];
+            if (supervisorB == supervisorA) continue;
+
+            const auto rowB = preferences.row(individual[b]);
+            const int64_t delta = int64_t{rowA[supervisorB]} + rowB[supervisorA] - currentA - rowB[supervisorB];
+            if (delta > bestDelta) {
+                bestDelta = delta;
+                bestSlot = b;
+            }
+        }
+        moves += span;
+
+        if (bestDelta > 0) {
+            std::swap(individual[a], individual[bestSlot]);
+            fitness += bestDelta;
+        }
+    }
+
+    return moves;
+}
+
+// Share of a local search budget for the i-th of count offspring, the shares add up to exactly budget
+inline size_t localSearchShare(size_t budget, size_t count, size_t i) {
+    return budget / count + (i < budget % count ? 1 : 0);
+}
+
+// One population of the allocation GA with its own generator, advanced a generation at a time
+// evolveAllocation runs a single island, evolveIslands runs several in parallel with migration between them
+class alloc_island {
+public:
+    alloc_island(const preference_matrix& preferences, const alloc_layout& layout, const alloc_config& config, uint64_t seed)
+        : preferences(preferences), layout(layout), config(config), rng(seed),
+          population(config.population, layout.slots()), repopulation(config.population, layout.slots()),
+          rates(config.mutationRate, config.crossoverFraction, 0.02, 1.0, 1.0, config.crossoverFraction),
+          offspringParent(config.population), tournament(config.tournamentSize) {
+        parentSelection.reserve(config.population);
+        parentFitness.reserve(config.population);
+        std::vector<student_id> unallocatedIds(std::max(preferences.studentCount, layout.slots()), 0);
+        result.best.resize(layout.slots());
+        result.mutationRate = rates.mutation, result.crossoverFraction = rates.crossover;
+
+        // Create an initial population of random allocations
+        // Every student is matched with a supervisor according to their capacity by shuffling all students into the slots,
+        // if capacity exceeds the student count the spare slots stay empty (0)
+        for (size_t i = 0; i != population.size(); i++) {
+            std::fill(unallocatedIds.begin(), unallocatedIds.end(), 0);
+            std::copy(preferences.studentRows.begin(), preferences.studentRows.end(), unallocatedIds.begin());
+            std::shuffle(unallocatedIds.begin(), unallocatedIds.end(), rng);
+
+            std::copy(unallocatedIds.begin(), unallocatedIds.begin() + layout.slots(), population.individual(i));
+            population.fitness[i] = calculateMappingCollectionFitness(preferences, layout, population.individual(i));
+        }
+        keepFittest(); // So summary() is a valid allocation before the first step
+    }
+
+    // Runs generation t, recording it in outputData if that is open
+    // Fitness is kept up to date incrementally by mutation and local search, so the profile counts
+    // each of those rescorings as a fitness call and their time shows up under those phases
+    // config.adaptive adjusts the rates from how many mutations improved their offspring and how diverse
+    // the population is, a population losing diversity widens its parent pool towards the whole population
+    void step(size_t t, trace_writer& outputData) {
+        const auto& fitness = population.fitness;
+        {
+            const auto timer = profile.time(ga_phase::output);
+            const auto generationFitness = std::accumulate(fitness.begin(), fitness.end(), size_t{0});
+            const auto best = std::max_element(fitness.begin(), fitness.end()) - fitness.begin();
+
+            const auto steadyState = config.selection == selection_mode::steady_state && result.generations != 0;
+            result.evaluations += steadyState ? config.steadyStateOffspring : population.size();
+            outputData.record(t, static_cast<double>(generationFitness) / population.size(),
+                              fitness[best], *std::min_element(fitness.begin(), fitness.end()));
+
+            // Only the single best individual is kept, copied into preallocated storage
+            if (fitness[best] > result.bestFitness) {
+                result.bestFitness = fitness[best];
+                std::copy(population.individual(best), population.individual(best) + layout.slots(), result.best.begin());
+            }
+
+            if (config.adaptive) {
+                rates.update(successes, trials, fitness);
+                successes = trials = 0;
+            }
+            result.mutationRate = rates.mutation, result.crossoverFraction = rates.crossover;
+        }
+
+        if (config.selection == selection_mode::steady_state) {
+            steadyStateStep();
+            result.generations++;
+            profile.endGeneration(t);
+            return;
+        }
+
+        // Reproduction/Crossover
+        // Selection, parents are indices into the current population
+        // Roulette picks a pool of parents and draws offspring from the pool until the next generation is full,
+        // tournament picks each offspring's parent directly
+        {
+            const auto timer = profile.time(ga_phase::selection);
+            if (config.selection == selection_mode::tournament) {
+                tournament.build(fitness);
+                for (size_t i = 0; i != repopulation.size(); i++) {
+                    offspringParent[i] = tournament.draw(rng);
+                }
+                profile.count(ga_counter::selection_draws, repopulation.size());
+            } else {
+                const auto parentCount = std::min(population.size(), std::max<size_t>(1, std::ceil(population.size() * rates.crossover)));
+                parentSelection.resize(parentCount), parentFitness.resize(parentCount); // Within the reserved capacity
+
+                wheel.build(fitness);
+                for (size_t i = 0; i != parentCount; i++) {
+                    parentSelection[i] = wheel.draw(rng);
+                    parentFitness[i] = fitness[parentSelection[i]];
+                }
+
+                wheel.build(parentFitness);
+                for (size_t i = 0; i != repopulation.size(); i++) {
+                    offspringParent[i] = parentSelection[wheel.draw(rng)];
+                }
+                profile.count(ga_counter::selection_draws, parentCount + repopulation.size());
+            }
+        }
+
+        // Crossover
+        // Each offspring keeps its parent's allocation, so it also keeps the parent's fitness unchanged
+        {
+            const auto timer = profile.time(ga_phase::crossover);
+            for (size_t i = 0; i != repopulation.size(); i++) {
+                repopulation.copyFrom(population, offspringParent[i], i);
+            }
+        }
+
+        // Mutate
+        // Mutation rate determines if each offspring is mutated, the gaps between mutated offspring
+        // are drawn directly so only the ones that mutate cost anything
+        {
+            const auto timer = profile.time(ga_phase::mutation);
+            const auto logFail = std::log(1.0 - std::min(rates.mutation, 1.0));
+            const auto count = repopulation.size();
+            size_t mutated{0};
+            for (auto i = std::min<uint64_t>(geometricSkip(rng, logFail), count); i < count; ) {
+                const auto before = repopulation.fitness[i];
+                swapMutate(preferences, layout, repopulation.individual(i), repopulation.fitness[i], rng);
+                successes += repopulation.fitness[i] > before;
+                mutated++;
+                i += 1 + std::min<uint64_t>(geometricSkip(rng, logFail), count - i);
+            }
+            profile.count(ga_counter::fitness_calls, mutated);
+            trials += mutated;
+        }
+
+        // Local search, the move budget is shared evenly between offspring
+        if (config.localSearchMoves != 0) {
+            const auto timer = profile.time(ga_phase::local_search);
+            const auto deadline = config.localSearchMicros == 0 ? std::chrono::steady_clock::time_point::max()
+                                                                : std::chrono::steady_clock::now() + std::chrono::microseconds(config.localSearchMicros);
+
+            for (size_t i = 0; i != repopulation.size() && std::chrono::steady_clock::now() < deadline; i++) {
+                const auto share = localSearchShare(config.localSearchMoves, repopulation.size(), i);
+                profile.count(ga_counter::local_search_moves, localSearch(preferences, layout, repopulation.individual(i), repopulation.fitness[i], rng, share, deadline));
+            }
+        }
+
+        std::swap(population, repopulation); // Swaps the buffers, not their contents
+        result.generations++;
+        profile.endGeneration(t);
+    }
+
+    // Indices of the count fittest individuals of the current population, fittest first
+    const std::vector<size_t>& fittest(size_t count) {
+        ranking.resize(population.size());
+        std::iota(ranking.begin(), ranking.end(), 0);
+        count = std::min(count, ranking.size());
+        std::partial_sort(ranking.begin(), ranking.begin() + count, ranking.end(),
+                          [this](size_t a, size_t b) { return population.fitness[a] > population.fitness[b]; });
+        ranking.resize(count);
+        return ranking;
+    }
+
+    // Replaces the least fit individual with an immigrant if the immigrant is fitter
+    void immigrate(const student_id* individual, size_t fitness) {
+        const auto worst = std::min_element(population.fitness.begin(), population.fitness.end()) - population.fitness.begin();
+        if (fitness <= population.fitness[worst]) return;
+
+        std::copy(individual, individual + layout.slots(), population.individual(worst));
+        population.fitness[worst] = fitness;
+    }
+
+    // Warm start, takes over individuals laid out for this island's layout and rescores them in full
+    // Earlier scores no longer apply, so the best so far restarts from the fittest of them
+    void reseed(const alloc_population& individuals) {
+        std::copy(individuals.ids.begin(), individuals.ids.end(), population.ids.begin());
+        for (size_t i = 0; i != population.size(); i++) {
+            population.fitness[i] = calculateMappingCollectionFitness(preferences, layout, population.individual(i));
+        }
+
+        keepFittest();
+        successes = trials = 0;
+    }
+
+    const alloc_population& current() const { return population; }
+    const alloc_result& summary() const { return result; }
+    const adaptive_rates& rateControl() const { return rates; }
+    ga_profile& profiler() { return profile; }
+
+    // Everything needed to carry on from the next generation, the spare buffer is rebuilt every step
+    void save(checkpoint_writer& out) const {
+        out.write(uint64_t{population.size()});
+        out.write(uint64_t{layout.slots()});
+        out.write(rng);
+        out.write(population.ids);
+        out.write(population.fitness);
+        out.write(result.best);
+        out.write(uint64_t{result.bestFitness});
+        out.write(uint64_t{result.generations});
+        out.write(uint64_t{result.evaluations});
+        rates.save(out);
+        out.write(uint64_t{successes});
+        out.write(uint64_t{trials});
+    }
+
+    void load(checkpoint_reader& in) {
+        uint64_t bestFitness, generations, evaluations, succeeded, tried;
+        in.expect(uint64_t{population.size()}, "population");
+        in.expect(uint64_t{layout.slots()}, "slot count");
+        in.read(rng);
+        in.read(population.ids);
+        in.read(population.fitness);
+        in.read(result.best);
+        in.read(bestFitness);
+        in.read(generations);
+        in.read(evaluations);
+        rates.load(in);
+        in.read(succeeded);
+        in.read(tried);
+
+        if (population.ids.size() != population.size() * layout.slots() || result.best.size() != layout.slots()) {
+            in.fail("population does not match this instance");
+        }
+        result.bestFitness = bestFitness, result.generations = generations, result.evaluations = evaluations;
+        successes = succeeded, trials = tried;
+        result.mutationRate = rates.mutation, result.crossoverFraction = rates.crossover;
+    }
+
+private:
+    // Copies the fittest individual of the population into result
+    void keepFittest() {
+        if (population.size() == 0) return;
+
+        const auto best = std::max_element(population.fitness.begin(), population.fitness.end()) - population.fitness.begin();
+        result.bestFitness = population.fitness[best];
+        std::copy(population.individual(best), population.individual(best) + layout.slots(), result.best.begin());
+    }
+
+    // Steady state, each offspring is a mutated copy of a tournament winner, made in the spare buffer,
+    // that replaces the loser of a reverse tournament if it is at least as fit
+    // Offspring fitness comes from the mutation's delta, so no individual is ever rescored in full
+    void steadyStateStep() {
+        auto child = repopulation.individual(0);
+        auto& childFitness = repopulation.fitness[0];
+        tournament.build(population.fitness);
+
+        for (size_t i = 0; i != config.steadyStateOffspring; i++) {
+            size_t parent, loser;
+            {
+                const auto timer = profile.time(ga_phase::selection);
+                parent = tournament.draw(rng);
+                profile.count(ga_counter::selection_draws, 1);
+            }
+            {
+                const auto timer = profile.time(ga_phase::crossover);
+                repopulation.copyFrom(population, parent, 0);
+            }
+            {
+                const auto timer = profile.time(ga_phase::mutation);
+                const auto before = childFitness;
+                swapMutate(preferences, layout, child, childFitness, rng);
+                successes += childFitness > before;
+                trials++;
+                profile.count(ga_counter::fitness_calls, 1);
+            }
+            if (config.localSearchMoves != 0) {
+                const auto timer = profile.time(ga_phase::local_search);
+                const auto deadline = config.localSearchMicros == 0 ? std::chrono::steady_clock::time_point::max()
+                                                                    : std::chrono::steady_clock::now() + std::chrono::microseconds(config.localSearchMicros);
+                profile.count(ga_counter::local_search_moves, localSearch(preferences, layout, child, childFitness, rng,
+                                                                          localSearchShare(config.localSearchMoves, config.steadyStateOffspring, i), deadline));
+            }
+            {
+                const auto timer = profile.time(ga_phase::selection);
+                loser = tournament.drawWorst(rng);
+            }
+
+            if (childFitness >= population.fitness[loser]) {
+                population.copyFrom(repopulation, 0, loser);
+            }
+        }
+    }
+
+    const preference_matrix& preferences;
+    const alloc_layout& layout;
+    const alloc_config config;
+    ga_rng rng;
+    alloc_population population, repopulation;
+    adaptive_rates rates;
+    size_t successes{0}, trials{0}; // Mutations that improved their offspring since the last rate update
+    std::vector<size_t> parentSelection, parentFitness, offspringParent, ranking;
+    alias_table wheel;
+    tournament_selection tournament;
+    alloc_result result;
+    ga_profile profile;
+};
+
+// An island checkpoint is the island itself plus its convergence state and whether the run had already stopped
+inline void saveIslandCheckpoint(const std::string& filename, const alloc_island& island, const convergence_monitor& monitor, bool finished) {
+    checkpoint_writer out(filename);
+    island.save(out);
+    out.write(uint64_t{monitor.stalled()});
+    out.write(monitor.elapsed());
+    out.write(finished);
+    if (!out.commit()) std::cerr << "Failed to write " << filename << std::endl;
+}
+
+// Restores island and monitor if filename exists, returns whether that run had finished
+inline bool loadIslandCheckpoint(const std::string& filename, alloc_island& island, convergence_monitor& monitor) {
+    checkpoint_reader in(filename);
+    if (!in.is_open()) return false;
+
+    uint64_t stalled;
+    double elapsed;
+    bool finished;
+    island.load(in);
+    in.read(stalled);
+    in.read(elapsed);
+    in.read(finished);
+    monitor.restore(elapsed, stalled, island.summary().bestFitness);
+
+    return finished;
+}
+
+// Evolves student to supervisor allocations, tracing the fitness of each generation to outputName.txt or .bin
+// An empty outputName runs without writing a trace, config.islands above 1 runs evolveIslands
+// The run ends early once config.stop is met, config.checkpointInterval and config.resume work as in evolve()
+inline const alloc_result evolveIslands(const preference_matrix& preferences, const supervisor_table& supervisors, std::mt19937_64& mt,
+                                        const alloc_config& config, const std::string& outputName);
+
+inline const alloc_result evolveAllocation(const preference_matrix& preferences, const supervisor_table& supervisors, std::mt19937_64& mt,
+                                           const alloc_config& config, const std::string& outputName) {
+    if (config.islands > 1) return evolveIslands(preferences, supervisors, mt, config, outputName);
+
+    const alloc_layout layout(supervisors);
+    alloc_island island(preferences, layout, config, mt());
+    convergence_monitor monitor(config.stop);
+    const auto checkpointName = outputName.empty() ? std::string() : outputName + ".ckpt";
+    const auto checkpointing = config.checkpointInterval != 0 && !checkpointName.empty();
+
+    auto finished = config.resume && !checkpointName.empty() && loadIslandCheckpoint(checkpointName, island, monitor);
+    trace_writer outputData(outputName, config.trace, island.summary().generations);
+    outputData.capture(config.history);
+    rate_log rateLog(config.adaptive ? outputName : "", island.summary().generations);
+    if (config.profile && !outputName.empty()) island.profiler().enable(1, config.profileSamples, config.generations);
+
+    // Run this mapping generator for t generations, or until the stopping criteria are met
+    for (auto t = island.summary().generations; t < config.generations && !finished; t++) {
+        island.step(t, outputData);
+        rateLog.record(t, island.rateControl().mutation, island.rateControl().crossover);
+        if (monitor.converged(island.summary().bestFitness)) break;
+
+        if (checkpointing && (t + 1) % config.checkpointInterval == 0) {
+            const auto timer = island.profiler().time(ga_phase::output);
+            outputData.flush();
+            rateLog.flush();
+            saveIslandCheckpoint(checkpointName, island, monitor, false);
+        }
+    }
+
+    if (checkpointing) saveIslandCheckpoint(checkpointName, island, monitor, true);
+    outputData.close();
+    if (!island.profiler().writeJson(outputName + "_profile.json", outputName, island.summary().generations)) {
+        std::cerr << "Failed to write " << outputName << "_profile.json" << std::endl;
+    }
+
+    return island.summary();
+}
+
+// Island model, config.islands populations evolve on their own threads with independent generators
+// Every config.migrationInterval generations each island sends copies of its config.migrants fittest individuals
+// to its neighbours over lock-free rings and takes in whatever has arrived, replacing its least fit individuals
+// Islands never wait for each other, a migrant that finds a full ring is dropped
+// Only island 0 is traced, the result is the best individual found on any island
+// Every island checks the stopping criteria against the best fitness of all islands and they stop together,
+// each island checkpoints to outputName.<island>.ckpt, migrants still in flight are not saved
+inline const alloc_result evolveIslands(const preference_matrix& preferences, const supervisor_table& supervisors, std::mt19937_64& mt,
+                                        const alloc_config& config, const std::string& outputName) {
+    const alloc_layout layout(supervisors);
+    const auto count = config.islands;
+
+    // Directed links between islands, ring sends to the next island only, complete sends to every other island
+    std::vector<std::pair<size_t, size_t>> links;
+    for (size_t from = 0; from != count; from++) {
+        for (size_t to = 0; to != count; to++) {
+            const auto neighbour = (to == (from + 1) % count);
+            if (from != to && (config.topology == migration_topology::complete || neighbour)) links.push_back({from, to});
+        }
+    }
+
+    std::vector<std::unique_ptr<migration_ring<student_id>>> rings;
+    std::vector<std::vector<size_t>> outgoing(count), incoming(count);
+    for (size_t l = 0; l != links.size(); l++) {
+        rings.emplace_back(new migration_ring<student_id>(std::max<size_t>(4, 4 * config.migrants), layout.slots()));
+        outgoing[links[l].first].push_back(l);
+        incoming[links[l].second].push_back(l);
+    }
+
+    std::vector<std::unique_ptr<alloc_island>> islands;
+    std::vector<std::unique_ptr<convergence_monitor>> monitors;
+    std::vector<std::string> checkpointNames(count);
+    std::vector<char> finished(count, false);
+    for (size_t i = 0; i != count; i++) {
+        islands.emplace_back(new alloc_island(preferences, layout, config, mt()));
+        monitors.emplace_back(new convergence_monitor(config.stop));
+        if (!outputName.empty()) checkpointNames[i] = outputName + "." + std::to_string(i) + ".ckpt";
+
+        // Loaded up front so a bad checkpoint throws here rather than on an island thread
+        if (config.resume && !outputName.empty()) finished[i] = loadIslandCheckpoint(checkpointNames[i], *islands[i], *monitors[i]);
+    }
+
+    if (config.profile && !outputName.empty()) islands[0]->profiler().enable(1, config.profileSamples, config.generations);
+
+    const auto checkpointing = config.checkpointInterval != 0 && !outputName.empty();
+    std::atomic<size_t> globalBest{0};
+    std::atomic<bool> stop{false};
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i != count; i++) {
+        threads.emplace_back([&, i] {
+            auto& island = *islands[i];
+            auto& monitor = *monitors[i];
+            trace_writer outputData(i == 0 ? outputName : "", config.trace, island.summary().generations);
+            if (i == 0) outputData.capture(config.history);
+            rate_log rateLog(i == 0 && config.adaptive ? outputName : "", island.summary().generations);
+            std::vector<student_id> arrival(layout.slots());
+            size_t arrivalFitness{0};
+
+            for (auto t = island.summary().generations; t < config.generations && !finished[i] && !stop.load(std::memory_order_relaxed); t++) {
+                island.step(t, outputData);
+                rateLog.record(t, island.rateControl().mutation, island.rateControl().crossover);
+
+                auto best = globalBest.load(std::memory_order_relaxed);
+                while (island.summary().bestFitness > best && !globalBest.compare_exchange_weak(best, island.summary().bestFitness)) {}
+                if (monitor.converged(std::max(best, island.summary().bestFitness))) stop.store(true, std::memory_order_relaxed);
+
+                if (config.migrationInterval != 0 && (t + 1) % config.migrationInterval == 0) {
+                    for (const auto index : island.fittest(config.migrants)) {
+                        for (const auto l : outgoing[i]) {
+                            rings[l]->tryPush(island.current().individual(index), island.current().fitness[index]);
+                        }
+                    }
+
+                    for (const auto l : incoming[i]) {
+                        while (rings[l]->tryPop(arrival.data(), arrivalFitness)) {
+                            island.immigrate(arrival.data(), arrivalFitness);
+                        }
+                    }
+                }
+
+                if (checkpointing && (t + 1) % config.checkpointInterval == 0) {
+                    outputData.flush();
+                    rateLog.flush();
+                    saveIslandCheckpoint(checkpointNames[i], island, monitor, false);
+                }
+            }
+
+            if (checkpointing) saveIslandCheckpoint(checkpointNames[i], island, monitor, true);
+        });
+    }
+
+    for (auto& thread : threads) thread.join();
+
+    if (!islands[0]->profiler().writeJson(outputName + "_profile.json", outputName, islands[0]->summary().generations)) {
+        std::cerr << "Failed to write " << outputName << "_profile.json" << std::endl;
+    }
+
+    alloc_result result = islands[0]->summary();
+    for (size_t i = 1; i != count; i++) {
+        const auto& summary = islands[i]->summary();
+        if (summary.bestFitness > result.bestFitness) {
+            result.bestFitness = summary.bestFitness;
+            result.best = summary.best;
+            result.mutationRate = summary.mutationRate, result.crossoverFraction = summary.crossoverFraction;
+        }
+        result.evaluations += summary.evaluations;
+    }
+
+    return result;
+}
+
+// Fitness function, higher is better
+// This counts preference in reverse order, with lecturers towards front of prefs having a higher score
+// Scores the students of one supervisor, by index into layout
+inline const size_t calculateFitness(const preference_matrix& preferences, const alloc_layout& layout, const student_id* individual, size_t supervisor) {
+    size_t fitness{0};
+    for (auto slot = layout.offsets[supervisor]; slot != layout.offsets[supervisor + 1]; slot++) {
+        fitness += preferences.score(individual[slot], supervisor);
+    }
+
+    return fitness;
+}
+
+inline const size_t calculateMappingCollectionFitness(const preference_matrix& preferences, const alloc_layout& layout, const student_id* individual) {
+    size_t fitness{0};
+    for (size_t slot = 0; slot != layout.slots(); slot++) {
+        fitness += preferences.score(individual[slot], layout.slotSupervisor[slot]);
+    }
+    
+    return fitness;
+}
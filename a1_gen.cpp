@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Writes synthetic allocation instances in the same quoted CSV format as Student-choices.csv and Supervisors.csv
+//
+// Usage: a1_gen [--students 1000] [--supervisors 100] [--distribution uniform|zipf|clustered]
+//               [--zipf-exponent 1.0] [--clusters 4] [--cluster-bias 10] [--preferences 0] [--seed 1]
+//               [--students-file students.csv] [--supervisors-file supervisors.csv]
+//
+// uniform     every student ranks supervisors in a uniformly random order
+// zipf        supervisors have a popularity that falls off as 1 / rank^exponent
+// clustered   supervisors are split into topic clusters, students favour their own cluster by cluster-bias
+//
+// --preferences limits each student to that many ranked supervisors, 0 ranks all of them like the shipped data
+// Capacities always sum exactly to the number of students, as the GA's initial population expects
+
+// Weighted random order without replacement (Efraimidis-Spirakis), higher weight tends to come first
+void weightedOrder(const vector<double>& weights, mt19937_64& mt, vector<pair<double, size_t>>& keys, vector<size_t>& order) {
+    uniform_real_distribution<double> random(0.0, 1.0);
+
+    keys.resize(weights.size());
+    for (size_t k = 0; k != weights.size(); k++) {
+        keys[k] = {log(random(mt)) / weights[k], k}; // log(u^(1/w)), larger is earlier
+    }
+
+    partial_sort(keys.begin(), keys.begin() + order.size(), keys.end(), greater<pair<double, size_t>>());
+    for (size_t i = 0; i != order.size(); i++) {
+        order[i] = keys[i].second;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    map<string, string> options{
+        {"--students", "1000"},
+        {"--supervisors", "100"},
+        {"--distribution", "uniform"},
+        {"--zipf-exponent", "1.0"},
+        {"--clusters", "4"},
+        {"--cluster-bias", "10"},
+        {"--preferences", "0"},
+        {"--seed", "1"},
+        {"--students-file", "students.csv"},
+        {"--supervisors-file", "supervisors.csv"},
+    };
+
+    for (auto i = 1; i + 1 < argc; i += 2) {
+        if (options.count(argv[i]) == 0) {
+            cerr << "Unknown option " << argv[i] << endl;
+            return 1;
+        }
+        options[argv[i]] = argv[i + 1];
+    }
+
+    const size_t students = stoull(options["--students"]), supervisors = stoull(options["--supervisors"]);
+    const auto distribution = options["--distribution"];
+    const size_t clusters = max<size_t>(1, stoull(options["--clusters"]));
+    const auto zipfExponent = stod(options["--zipf-exponent"]), clusterBias = stod(options["--cluster-bias"]);
+    auto preferences = stoull(options["--preferences"]);
+    if (preferences == 0 || preferences > supervisors) preferences = supervisors;
+
+    if (students == 0 || supervisors == 0) {
+        cerr << "Need at least one student and one supervisor" << endl;
+        return 1;
+    }
+    if (distribution != "uniform" && distribution != "zipf" && distribution != "clustered") {
+        cerr << "Unknown distribution " << distribution << endl;
+        return 1;
+    }
+
+    mt19937_64 mt(stoull(options["--seed"]));
+
+    // Capacities, an even share each with the remainder going to random supervisors
+    vector<size_t> capacities(supervisors, students / supervisors), supervisorOrder(supervisors);
+    iota(supervisorOrder.begin(), supervisorOrder.end(), 0);
+    shuffle(supervisorOrder.begin(), supervisorOrder.end(), mt);
+    for (size_t i = 0; i != students % supervisors; i++) {
+        capacities[supervisorOrder[i]]++;
+    }
+
+    // Popularity weights, supervisorOrder doubles as the popularity ranking for zipf and the cluster assignment for clustered
+    vector<double> weights(supervisors, 1.0);
+    if (distribution == "zipf") {
+        for (size_t rank = 0; rank != supervisors; rank++) {
+            weights[supervisorOrder[rank]] = 1.0 / pow(rank + 1, zipfExponent);
+        }
+    }
+
+    ofstream studentsFile(options["--students-file"]);
+    string buffer;
+    vector<double> studentWeights(weights);
+    vector<pair<double, size_t>> keys;
+    vector<size_t> order(preferences);
+    uniform_int_distribution<size_t> randomCluster(0, clusters - 1);
+
+    for (size_t s = 0; s != students; s++) {
+        if (distribution == "clustered") {
+            const auto cluster = randomCluster(mt);
+            for (size_t rank = 0; rank != supervisors; rank++) {
+                studentWeights[supervisorOrder[rank]] = (rank % clusters == cluster) ? clusterBias : 1.0;
+            }
+        }
+
+        weightedOrder(studentWeights, mt, keys, order);
+
+        buffer += "\"Student_" + to_string(s + 1) + "\"";
+        for (const auto k : order) {
+            buffer += ",\"" + to_string(k + 1) + "\"";
+        }
+        buffer += '\n';
+
+        // Written out in blocks so large instances never sit in memory whole
+        if (buffer.size() > (1 << 20)) {
+            studentsFile.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+
+    studentsFile.write(buffer.data(), buffer.size());
+
+    buffer.clear();
+    for (size_t k = 0; k != supervisors; k++) {
+        buffer += "\"Supervisor_" + to_string(k + 1) + "\",\"" + to_string(capacities[k]) + "\"\n";
+    }
+
+    ofstream supervisorsFile(options["--supervisors-file"]);
+    supervisorsFile.write(buffer.data(), buffer.size());
+
+    if (!studentsFile || !supervisorsFile) {
+        cerr << "Failed to write output files" << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,247 @@
+#include "a1_csv.h"
+#include "a1_ga.h"
+#include "a1_flow.h"
+#include "a1_service.h"
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Resident allocation service, keeps the instance and population in memory and answers edits to them
+//
+// Usage: a1_service [socket PATH] [students Student-choices.csv] [supervisors Supervisors.csv] [seed S]
+//                   [idle 5000] [batch-us 1000] [population 20] [selection roulette|tournament|steady]
+//                   [tournament K] [offspring N] [local L] [adaptive]
+//
+// Commands are read one per line from stdin, or from clients of a Unix socket at PATH, one client at a time:
+//   prefs STUDENT SUPERVISOR...   replace a student's preferences, most preferred first
+//   add STUDENT SUPERVISOR...     add a student with these preferences
+//   remove STUDENT                remove a student
+//   capacity SUPERVISOR N         change a supervisor's capacity, at most the number of students
+//   best                          print the best allocation
+//   status                        print generation, best fitness, student and slot counts, and whether it is idle
+//   optimum                       print the optimal fitness from the exact solver, for comparison
+//   quit                          end the session, a socket client disconnects and the service keeps running
+// Edits answer "ok FITNESS MICROSECONDS" once the population is repaired, errors answer "error MESSAGE"
+// Between commands the GA runs in batch-us slices and streams every new best as "improved FITNESS GENERATION ...",
+// after idle generations without one it waits for the next edit
+// Allocations are "SUPERVISOR:STUDENT,STUDENT SUPERVISOR:..." groups, empty slots are left out
+
+// Set by SIGINT and SIGTERM so the service can remove its socket on the way out
+volatile sig_atomic_t stopRequested = 0;
+
+// Allocation line shared by best and improved
+const string formatAllocation(const string& label, const allocation_service& service) {
+    const auto& best = service.best();
+    const auto& layout = service.currentLayout();
+    string line = label + " " + to_string(best.bestFitness) + " " + to_string(service.generations());
+
+    for (size_t k = 0; k != layout.supervisors(); k++) {
+        line += " " + to_string(layout.supervisorIds[k]) + ":";
+        auto first = true;
+        for (auto slot = layout.offsets[k]; slot != layout.offsets[k + 1]; slot++) {
+            if (best.best[slot] == 0) continue;
+            line += (first ? "" : ",") + to_string(service.instance().studentIds[best.best[slot]]);
+            first = false;
+        }
+    }
+
+    return line + "\n";
+}
+
+// Writes all of text to fd, false if the other end has gone
+bool sendAll(int fd, const string& text) {
+    for (size_t sent = 0; sent != text.size(); ) {
+        const auto n = ::write(fd, text.data() + sent, text.size() - sent);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+// Runs one command line, appending the answer to reply, false once the session should end
+bool handleCommand(allocation_service& service, const string& line, string& reply) {
+    istringstream in(line);
+    string command;
+    if (!(in >> command)) return true;
+
+    const auto start = chrono::steady_clock::now();
+    try {
+        size_t id, value;
+        vector<size_t> preferences;
+
+        if (command == "prefs" || command == "add") {
+            if (!(in >> id)) throw invalid_argument("expected a student id");
+            while (in >> value) preferences.push_back(value);
+            if (preferences.empty()) throw invalid_argument("expected preferences");
+
+            const auto known = service.instance().hasStudent(id);
+            if (command == "prefs" && !known) throw invalid_argument("unknown student " + to_string(id));
+            if (command == "add" && known) throw invalid_argument("student " + to_string(id) + " already exists");
+            service.setPreferences(id, preferences);
+        } else if (command == "remove") {
+            if (!(in >> id)) throw invalid_argument("expected a student id");
+            service.removeStudent(id);
+        } else if (command == "capacity") {
+            if (!(in >> id >> value)) throw invalid_argument("expected a supervisor id and capacity");
+            // No supervisor can take more students than there are, and every slot costs memory in each individual
+            if (value > service.students()) throw invalid_argument("capacity above the " + to_string(service.students()) + " students");
+            service.setCapacity(id, value);
+        } else if (command == "best") {
+            reply += formatAllocation("allocation", service);
+            return true;
+        } else if (command == "status") {
+            reply += "status " + to_string(service.generations()) + " " + to_string(service.best().bestFitness) + " " +
+                     to_string(service.students()) + " " + to_string(service.currentLayout().slots()) + " " +
+                     (service.isIdle() ? "idle" : "running") + "\n";
+            return true;
+        } else if (command == "optimum") {
+            reply += "optimum " + to_string(solveAllocation(service.instance(), service.supervisorTable()).bestFitness) + "\n";
+            return true;
+        } else if (command == "quit") {
+            reply += "bye\n";
+            return false;
+        } else {
+            reply += "error unknown command " + command + "\n";
+            return true;
+        }
+    } catch (const exception& e) {
+        reply += string("error ") + e.what() + "\n";
+        return true;
+    }
+
+    const auto micros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+    reply += "ok " + to_string(service.best().bestFitness) + " " + to_string(micros) + "\n";
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    alloc_config config;
+    config.stop.stallGenerations = 5000;
+    string socketPath, studentsFile("Student-choices.csv"), supervisorsFile("Supervisors.csv");
+    uint64_t seed = random_device{}();
+    size_t batchMicros{1000};
+
+    try {
+        for (auto i = 1; i < argc; i++) {
+            const string arg(argv[i]);
+            const string value(i + 1 < argc ? argv[i + 1] : "");
+
+            if (arg == "socket") socketPath = value, i++;
+            else if (arg == "students") studentsFile = value, i++;
+            else if (arg == "supervisors") supervisorsFile = value, i++;
+            else if (arg == "seed") seed = stoull(value), i++;
+            else if (arg == "idle") config.stop.stallGenerations = stoul(value), i++;
+            else if (arg == "batch-us") batchMicros = stoul(value), i++;
+            else if (arg == "population") config.population = stoul(value), i++;
+            else if (arg == "selection") config.selection = parseSelectionMode(value), i++;
+            else if (arg == "tournament") config.tournamentSize = stoul(value), i++;
+            else if (arg == "offspring") config.steadyStateOffspring = stoul(value), i++;
+            else if (arg == "local") config.localSearchMoves = stoul(value), i++;
+            else if (arg == "adaptive") config.adaptive = true;
+            else throw invalid_argument("Unknown option " + arg);
+        }
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    student_table students;
+    supervisor_table supervisors;
+    try {
+        supervisors = parseSupervisorsCsv(supervisorsFile);
+        students = parseStudentsCsv(studentsFile, supervisors);
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    allocation_service service(buildPreferenceMatrix(students, supervisors), supervisors, config, seed);
+    cerr << "Serving " << service.students() << " students, seed " << seed << "." << endl;
+
+    // Without a socket the session is stdin and stdout, with one it is whichever client is connected
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, [](int) { stopRequested = 1; });
+    signal(SIGTERM, [](int) { stopRequested = 1; });
+    auto listener = -1, in = 0, out = 1;
+    if (!socketPath.empty()) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path)) {
+            cerr << "Socket path too long" << endl;
+            return 1;
+        }
+        socketPath.copy(address.sun_path, socketPath.size());
+        unlink(socketPath.c_str());
+
+        listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 4) != 0) {
+            cerr << "Cannot listen on " << socketPath << endl;
+            return 1;
+        }
+        in = out = -1;
+    }
+
+    string pending, reply;
+    char buffer[4096];
+    auto reported = service.best().bestFitness;
+
+    while (!stopRequested) {
+        // Block only while there is nothing to evolve
+        pollfd waiting{in >= 0 ? in : listener, POLLIN, 0};
+        if (poll(&waiting, 1, service.isIdle() ? -1 : 0) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        if (waiting.revents != 0 && in < 0) {
+            in = out = accept(listener, nullptr, nullptr);
+            if (in >= 0) sendAll(out, formatAllocation("allocation", service));
+        } else if (waiting.revents != 0) {
+            const auto n = ::read(in, buffer, sizeof(buffer));
+            auto open = n > 0 || (n < 0 && errno == EINTR);
+            if (n > 0) pending.append(buffer, n);
+
+            // Every complete line is answered before the GA runs again
+            size_t newline;
+            while (open && (newline = pending.find('\n')) != string::npos) {
+                open = handleCommand(service, pending.substr(0, newline), reply);
+                pending.erase(0, newline + 1);
+            }
+            if (!reply.empty() && !sendAll(out, reply)) open = false;
+            reply.clear();
+            reported = service.best().bestFitness;
+
+            if (!open) {
+                if (listener < 0) break;
+                close(in);
+                in = out = -1;
+                pending.clear();
+            }
+        }
+
+        service.evolve(SIZE_MAX, chrono::steady_clock::now() + chrono::microseconds(batchMicros));
+        if (service.best().bestFitness != reported) {
+            reported = service.best().bestFitness;
+            if (out >= 0) sendAll(out, formatAllocation("improved", service));
+        }
+    }
+
+    if (listener >= 0) {
+        close(listener);
+        unlink(socketPath.c_str());
+    }
+
+    return 0;
+}
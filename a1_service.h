@@ -0,0 +1,173 @@
+#pragma once
+
+#include "a1_csv.h"
+#include "a1_ga.h"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// The allocation GA kept resident between edits to its instance
+// An edit repairs the population for the new instance rather than starting again: every individual keeps each
+// student where they were wherever that is still allowed, and only students who lost their place or are new
+// are placed, each in the free slot they score highest, the best so far is then hill climbed and kept
+// evolve() carries on from the repaired population, a run of config.stop.stallGenerations without a new best
+// counts as idle until the next edit
+class allocation_service {
+public:
+    static constexpr size_t REPAIR_SWEEPS = 50; // Local search sweeps given to the repaired best
+
+    allocation_service(const preference_matrix& preferences, const supervisor_table& supervisors, const alloc_config& config, uint64_t seed)
+        : preferences(preferences), supervisors(supervisors), config(config), mt(seed), rng(mt()),
+          layout(new alloc_layout(supervisors)), island(new alloc_island(this->preferences, *layout, config, mt())),
+          monitor(config.stop), repaired(config.population, layout->slots()) {}
+
+    allocation_service(const allocation_service&) = delete;
+    allocation_service& operator=(const allocation_service&) = delete;
+
+    // Edits, each throws std::invalid_argument for an unknown student or supervisor and leaves the instance as it was
+
+    // Replaces a student's preferences, supervisor ids most preferred first, adding the student if they are new
+    void setPreferences(size_t studentId, const std::vector<size_t>& studentPreferences) {
+        columns.clear();
+        for (const auto id : studentPreferences) {
+            const auto found = std::find(supervisors.ids.begin(), supervisors.ids.end(), id);
+            if (found == supervisors.ids.end()) throw std::invalid_argument("unknown supervisor " + std::to_string(id));
+            columns.push_back(found - supervisors.ids.begin());
+        }
+        setStudentPreferences(preferences, studentId, columns);
+        repair(*layout);
+    }
+
+    void removeStudent(size_t studentId) {
+        ::removeStudent(preferences, studentId);
+        repair(*layout);
+    }
+
+    // The table changes only once the new layout is built and the population repaired for it
+    void setCapacity(size_t supervisorId, size_t capacity) {
+        const auto found = std::find(supervisors.ids.begin(), supervisors.ids.end(), supervisorId);
+        if (found == supervisors.ids.end()) throw std::invalid_argument("unknown supervisor " + std::to_string(supervisorId));
+
+        auto changed = supervisors;
+        changed.capacities[found - supervisors.ids.begin()] = capacity;
+        std::unique_ptr<alloc_layout> resized(new alloc_layout(changed));
+        repair(*resized);
+        layout.swap(resized);
+        supervisors.capacities.swap(changed.capacities);
+    }
+
+    // Runs up to generations generations or until deadline, nothing while idle
+    void evolve(size_t generations, std::chrono::steady_clock::time_point deadline) {
+        for (size_t g = 0; g != generations && !idle && std::chrono::steady_clock::now() < deadline; g++) {
+            island->step(generation++, noTrace);
+            idle = monitor.converged(island->summary().bestFitness);
+        }
+    }
+
+    bool isIdle() const { return idle; }
+    size_t generations() const { return generation; }
+    size_t students() const { return preferences.studentCount; }
+    const alloc_result& best() const { return island->summary(); }
+    const alloc_layout& currentLayout() const { return *layout; }
+    const preference_matrix& instance() const { return preferences; }
+    const supervisor_table& supervisorTable() const { return supervisors; }
+
+private:
+    // Rebuilds every individual and the best so far for the edited instance laid out by to, then reseeds from them
+    // The best so far replaces the least fit individual, a new layout gets a new island
+    void repair(const alloc_layout& to) {
+        const auto& from = *layout;
+        const auto& population = island->current();
+
+        wanted.assign(preferences.studentIds.size(), 0);
+        for (const auto student : preferences.studentRows) wanted[student] = 1;
+
+        if (repaired.slots != to.slots()) repaired = alloc_population(population.size(), to.slots());
+        for (size_t i = 0; i != population.size(); i++) {
+            repairIndividual(from, population.individual(i), to, repaired.individual(i));
+        }
+
+        elite.resize(to.slots());
+        repairIndividual(from, island->summary().best.data(), to, elite.data());
+        auto eliteFitness = calculateMappingCollectionFitness(preferences, to, elite.data());
+        localSearch(preferences, to, elite.data(), eliteFitness, rng, REPAIR_SWEEPS * to.slots(), std::chrono::steady_clock::time_point::max());
+
+        const auto worst = std::min_element(population.fitness.begin(), population.fitness.end()) - population.fitness.begin();
+        std::copy(elite.begin(), elite.end(), repaired.individual(worst));
+
+        if (&to != layout.get()) island.reset(new alloc_island(preferences, to, config, mt()));
+        island->reseed(repaired);
+        monitor.restore(0, 0, island->summary().bestFitness);
+        idle = false;
+    }
+
+    // Lays out individual from for layout to, supervisors keep the students they still have room for, their
+    // best scoring ones if they shrank, students no longer in the instance are dropped and everyone left over
+    // goes to the free slot they score highest, or stays unallocated if there is none
+    void repairIndividual(const alloc_layout& from, const student_id* individual, const alloc_layout& to, student_id* out) {
+        placed.assign(wanted.size(), 0);
+        nextFree.resize(to.supervisors());
+        std::fill(out, out + to.slots(), 0);
+
+        for (size_t k = 0; k != to.supervisors(); k++) {
+            kept.clear();
+            for (auto slot = from.offsets[k]; slot != from.offsets[k + 1]; slot++) {
+                const auto id = individual[slot];
+                if (id != 0 && id < wanted.size() && wanted[id] && !placed[id]) kept.push_back(id);
+            }
+
+            const auto capacity = to.offsets[k + 1] - to.offsets[k];
+            if (kept.size() > capacity) {
+                std::stable_sort(kept.begin(), kept.end(), [&](student_id a, student_id b) {
+                    return preferences.score(a, k) > preferences.score(b, k);
+                });
+                kept.resize(capacity);
+            }
+
+            nextFree[k] = to.offsets[k];
+            for (const auto id : kept) {
+                out[nextFree[k]++] = id;
+                placed[id] = 1;
+            }
+        }
+
+        for (const auto id : preferences.studentRows) {
+            if (placed[id]) continue;
+
+            size_t target = to.supervisors();
+            for (size_t k = 0; k != to.supervisors(); k++) {
+                if (nextFree[k] != to.offsets[k + 1] && (target == to.supervisors() ||
+                    preferences.score(id, k) > preferences.score(id, target))) {
+                    target = k;
+                }
+            }
+            if (target == to.supervisors()) break; // Every slot is taken
+
+            out[nextFree[target]++] = id;
+            placed[id] = 1;
+        }
+    }
+
+    preference_matrix preferences;
+    supervisor_table supervisors;
+    const alloc_config config;
+    std::mt19937_64 mt;
+    ga_rng rng;
+    std::unique_ptr<alloc_layout> layout;
+    std::unique_ptr<alloc_island> island;
+    convergence_monitor monitor;
+    trace_writer noTrace;
+    size_t generation{0};
+    bool idle{false};
+
+    // Repair scratch, kept between edits so their storage is reused
+    alloc_population repaired;
+    std::vector<student_id> elite, kept;
+    std::vector<size_t> columns;
+    std::vector<char> wanted, placed;
+    std::vector<size_t> nextFree;
+};
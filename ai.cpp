@@ -1,3 +1,4 @@
+#define GA_COUNT_ALLOCATIONS // Lets the profiler count allocations, see ga_profile.h
 #include <iostream>
 #include <random>
 #include <vector>
@@ -7,182 +8,92 @@
 
 using namespace std;
 
-const auto INITIAL_POPULATION = 10; // Must be even
-const auto STRING_LENGTH = 30;
-const auto GENERATIONS = 1000;
-
-int main() {
-    mt19937_64 mt(random_device{}()); // Mersenne Twister random number generator
-
-    cout << "Running each for " << GENERATIONS << " generations." << endl;
-    processProblem(mt, problemAFitness, problemAMutate, "Onemax");
-    processProblem(mt, problemBFitness, problemAMutate, "Evolve");
-    processProblem(mt, problemCFitness, problemAMutate, "Landscape");
-    processProblem(mt, problemDFitness, problemDMutate, "Evolve2");
-}
-
-// Takes an MT, a fitness function, a mutate function, and the name of the output txt file
-const void processProblem(mt19937_64& mt, fitness_func fitnessFunc, mutate_func mutateFunc, const string& outputName) {
-    uniform_int_distribution<int> randomInt(0, 1); // Used to generate random 0's and 1's
-    vector<string> population{INITIAL_POPULATION}, repopulation{}, parents{}; // Population holds current generation, repop. holds next generation's parents
-    size_t totalFitness{0}, maxFitness{0};
-    string buffer{};
-
-    for (auto i = 0; i != population.size(); i++) {
-        for (auto j = 0; j != STRING_LENGTH; j++) {
-            buffer += to_string(randomInt(mt));
+// Usage: ai [threads] [seed] [text|binary] [optimum] [stall N] [seconds S] [checkpoint N] [resume] [profile] [samples]
+//          [selection roulette|tournament|steady] [tournament K] [offspring N] [mutation P] [crossover P] [adaptive]
+// optimum stops each problem once it is solved, stall after N generations without improvement,
+// seconds after S seconds of wall clock time per problem
+// checkpoint snapshots each problem to <name>.ckpt every N generations, resume continues from those snapshots,
+// which needs the same seed and thread count to carry on exactly where the run stopped
+// profile writes per-phase times and counters to <name>_profile.json, samples adds one entry per generation
+// selection picks parents by roulette wheel (default) or K-way tournament, steady replaces only N offspring per generation
+// mutation and crossover set the starting chances, 0.3 and 1 by default, adaptive adjusts them every generation
+// and logs the rates used to <name>_rates.txt
+// threads and seed come first, the rest may be given in any order and an unknown one is an error
+int main(int argc, char* argv[]) {
+    ga_config config;
+    uint64_t seed;
+    try {
+        config.threads = argc > 1 ? stoul(argv[1]) : 1;
+        seed = argc > 2 ? stoull(argv[2]) : random_device{}();
+
+        for (auto i = 3; i < argc; i++) {
+            const string arg(argv[i]);
+            const string value(i + 1 < argc ? argv[i + 1] : "0");
+
+            if (arg == "text") config.trace = trace_format::text;
+            else if (arg == "binary") config.trace = trace_format::binary;
+            else if (arg == "optimum") config.stopAtOptimum = true;
+            else if (arg == "stall") config.stop.stallGenerations = stoul(value), i++;
+            else if (arg == "seconds") config.stop.seconds = stod(value), i++;
+            else if (arg == "checkpoint") config.checkpointInterval = stoul(value), i++;
+            else if (arg == "resume") config.resume = true;
+            else if (arg == "profile") config.profile = true;
+            else if (arg == "samples") config.profile = config.profileSamples = true;
+            else if (arg == "selection") config.selection = parseSelectionMode(value), i++;
+            else if (arg == "tournament") config.tournamentSize = stoul(value), i++;
+            else if (arg == "offspring") config.steadyStateOffspring = stoul(value), i++;
+            else if (arg == "mutation") config.mutationChance = stod(value), i++;
+            else if (arg == "crossover") config.crossoverChance = stod(value), i++;
+            else if (arg == "adaptive") config.adaptive = true;
+            else throw invalid_argument("Unknown option " + arg);
         }
-        
-        population[i] = buffer;
-        buffer.clear();
-    } 
-
-    ofstream outputData(outputName + ".txt");
-
-    // Problem D requires a better population seed than 0's and 1's
-    if (outputName == "Evolve2") {
-        uniform_int_distribution<int> randomDigit(0, 9);
-
-        for (auto i = 0; i != population.size(); i++) {
-            for (auto j = 0; j != STRING_LENGTH; j++) {
-                buffer += to_string(randomDigit(mt));
-            }
-        
-            population[i] = buffer;
-            buffer.clear();
-        } 
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
     }
-
-    // Run for T generations
-    for (auto t = 0; t != GENERATIONS; t++) {
-
-        totalFitness = 0;
-        for (auto i = 0; i != population.size(); i++) {
-            totalFitness += fitnessFunc(population[i]);
-        }
-
-        outputData << t << " " << (totalFitness / population.size()) << endl;
-
-        uniform_int_distribution<int> randomFitness(0, totalFitness);
-        auto target = 0, fitness = 0;
-        for (auto i = 0; i != population.size(); i++) {
-            fitness = 0;
-            target = randomFitness(mt);
-
-            for (const auto& s : population) {
-                fitness += fitnessFunc(s);
-                if (fitnessFunc(s) > maxFitness) {
-                    maxFitness = fitnessFunc(s);
-                }
-
-                if (fitness >= target) {
-                    parents.emplace_back(move(s));
-                    break;
-                }
-            }
-        }
-
-        //population.clear();
-
-        // Reproduction
-        // Generate crossover bit location, from 1 to STRING_LENGTH - 1
-        uniform_int_distribution<int> randomCrossover(0, STRING_LENGTH - 1);
-        auto crossoverBit = 0;
-        for (auto i = 0; i < parents.size(); i += 2) {
-            crossoverBit = randomCrossover(mt);
-
-            auto offspringA = parents[i].substr(0, crossoverBit) + parents[i+1].substr(crossoverBit);
-            auto offspringB = parents[i+1].substr(0, crossoverBit) + parents[i].substr(crossoverBit);
-
-            repopulation.emplace_back(move(offspringA));
-            repopulation.emplace_back(move(offspringB));
-        }
-
-        // Mutation
-        mutateFunc(repopulation, mt);
-
-        population.swap(repopulation);
-        parents.clear();
-        repopulation.clear();
+    mt19937_64 mt(seed); // Mersenne Twister random number generator
+
+    cout << "Running each for " << config.generations << " generations on " << config.threads << " thread(s), seed " << seed << "." << endl;
+    try {
+        processProblem<problem_a_fitness, problem_a_mutate>(mt, "Onemax", config);
+        processProblem<problem_b_fitness, problem_a_mutate>(mt, "Evolve", config);
+        processProblem<problem_c_fitness, problem_a_mutate>(mt, "Landscape", config);
+        processProblem<problem_d_fitness, problem_d_mutate>(mt, "Evolve2", config);
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
     }
-
-    outputData.close();
-    cout << outputName << " finished. Max fitness: " << maxFitness << endl;
 }
 
-const void problemAMutate(vector<string>& population, mt19937_64& mt) {
-    uniform_int_distribution<int> randomMutateChance(0, 100);
-    uniform_int_distribution<int> randomBit(0, STRING_LENGTH - 1);
-
-    auto bit = 0;
-    for (auto i = 0; i != population.size(); i++) {
-        if (randomMutateChance(mt) <= 30) {
-            bit = randomBit(mt);
-            population[i][bit] ^= 1u;
-        }
-    }
+// Takes an MT, a fitness function, a mutate function, the name of the output txt file and the run parameters
+const void processProblem(mt19937_64& mt, fitness_func fitnessFunc, mutate_func mutateFunc, const string& outputName, const ga_config& config) {
+    evolve<string>(mt, fitnessFunc, mutateFunc, outputName, config);
 }
 
-const void problemDMutate(vector<string>& population, mt19937_64& mt) {
-    uniform_int_distribution<int> randomMutateChance(0, 100);
-    uniform_int_distribution<int> randomBit(0, STRING_LENGTH - 1);
-    uniform_int_distribution<int> randDigit(0, 9);
-
-    auto bit = 0;
-    for (auto i = 0; i != population.size(); i++) {
-        if (randomMutateChance(mt) <= 30) {
-            bit = randomBit(mt);
-            population[i][bit] = randDigit(mt);
-        }
-    }
+const void processProblem(mt19937_64& mt, bit_fitness_func fitnessFunc, bit_mutate_func mutateFunc, const string& outputName, const ga_config& config) {
+    evolve<bit_genome>(mt, fitnessFunc, mutateFunc, outputName, config);
 }
 
-const size_t problemAFitness(const string& s) {
-    size_t fitnessCounter{0};
-
-    for (const auto& c : s) {
-        if (c == '1') fitnessCounter++;
-    }
-
-    return fitnessCounter;
+const void problemAMutate(vector<bit_genome>& population, size_t first, size_t last, double chance, ga_rng& rng) {
+    problem_a_mutate{}(population, first, last, chance, rng);
 }
 
-const size_t problemBFitness(const string& s) {
-    const string targetString("110110111011001010110101011010");
-    size_t fitnessCounter{0};
-
-    for (auto i = 0; i != s.length(); i++) {
-        if (s.at(i) == targetString.at(i)) {
-            fitnessCounter++;
-        }
-    }
-
-    return fitnessCounter;
+const void problemDMutate(vector<string>& population, size_t first, size_t last, double chance, ga_rng& rng) {
+    problem_d_mutate{}(population, first, last, chance, rng);
 }
 
-const size_t problemCFitness(const string& s) {
-    size_t fitnessCounter{0};
-
-    for (const auto& c : s) {
-        if (c == '1') fitnessCounter++;
-    }
+const size_t problemAFitness(const bit_genome& g) {
+    return problem_a_fitness{}(g);
+}
 
-    if (fitnessCounter == 0) {
-        return 2 * s.length();
-    }
+const size_t problemBFitness(const bit_genome& g) {
+    return problem_b_fitness{}(g);
+}
 
-    return fitnessCounter;
+const size_t problemCFitness(const bit_genome& g) {
+    return problem_c_fitness{}(g);
 }
 
 const size_t problemDFitness(const string& s) {
-    const string targetString2("129384373440352123804353457823");
-    size_t fitnessCounter{0};
-
-    for (auto i = 0; i != s.length(); i++) {
-        if (s.at(i) == targetString2.at(i)) {
-            fitnessCounter++;
-        }
-    }
-
-    return fitnessCounter;
+    return problem_d_fitness{}(s);
 }
\ No newline at end of file
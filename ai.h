@@ -1,18 +1,524 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
 #include <functional>
+#include <iostream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <random>
+#include "bit_genome.h"
+#include "nibble_genome.h"
+#include "ga_random.h"
+#include "ga_select.h"
+#include "ga_pool.h"
+#include "ga_trace.h"
+#include "ga_stop.h"
+#include "ga_checkpoint.h"
+#include "ga_profile.h"
+#include "ga_adapt.h"
+
+constexpr size_t INITIAL_POPULATION = 10; // Must be even
+constexpr size_t STRING_LENGTH = 30;
+constexpr size_t GENERATIONS = 1000;
+constexpr double MUTATION_CHANCE = 0.3; // Probability that an individual is mutated
+
+// Run parameters, defaults are the original assignment settings
+struct ga_config {
+    size_t population{INITIAL_POPULATION}; // Must be even
+    size_t length{STRING_LENGTH};
+    size_t generations{GENERATIONS};
+    size_t threads{1};
+    trace_format trace{trace_format::text};
+    stop_criteria stop;
+    bool stopAtOptimum{false}; // processProblem sets stop.targetFitness to the problem's optimum
+    size_t checkpointInterval{0}; // Generations between checkpoints to outputName.ckpt, 0 for none
+    bool resume{false}; // Continue from outputName.ckpt if it exists
+    bool profile{false}; // Write per-phase times and counters to outputName_profile.json
+    bool profileSamples{false}; // Also keep one profile sample per generation
+    std::vector<trace_record>* history{nullptr}; // If set, every generation's trace record is appended here too
+    selection_mode selection{selection_mode::roulette};
+    size_t tournamentSize{2};
+    size_t steadyStateOffspring{2}; // Offspring made per generation in steady_state mode, rounded up to a pair
+    double mutationChance{MUTATION_CHANCE};
+    double crossoverChance{1.0}; // Probability that a pair is crossed over rather than copied
+    bool adaptive{false}; // Adjust both rates every generation, see adaptive_rates, and log them to outputName_rates.txt
+};
+
+struct ga_result {
+    size_t maxFitness{0};
+    size_t generations{0};
+    size_t evaluations{0}; // Fitness function calls
+    double mutationChance{0}, crossoverChance{0}; // Rates used in the last generation
+};
 
 typedef const std::function<const size_t(const std::string&)>& fitness_func;
-typedef const std::function<void(std::vector<std::string>&, std::mt19937_64&)>& mutate_func;
+typedef const std::function<void(std::vector<std::string>&, size_t, size_t, double, ga_rng&)>& mutate_func; // Mutates population[first, last), each with the given chance
+typedef const std::function<const size_t(const bit_genome&)>& bit_fitness_func;
+typedef const std::function<void(std::vector<bit_genome>&, size_t, size_t, double, ga_rng&)>& bit_mutate_func;
 
+// Runtime-chosen problems, thin wrappers over evolve() below
 const void processProblem(std::mt19937_64& mt, 
                           fitness_func fitnessFunc,
                           mutate_func mutateFunc,
-                         const std::string& outputName);
-const void problemAMutate(std::vector<std::string>& population, std::mt19937_64& mt); // Used for A, B, C
-const void problemDMutate(std::vector<std::string>& population, std::mt19937_64& mt);
-const size_t problemAFitness(const std::string& s);
-const size_t problemBFitness(const std::string& s);
-const size_t problemCFitness(const std::string& s);
-const size_t problemDFitness(const std::string& s);
\ No newline at end of file
+                         const std::string& outputName,
+                         const ga_config& config = ga_config{});
+const void processProblem(std::mt19937_64& mt, 
+                          bit_fitness_func fitnessFunc,
+                          bit_mutate_func mutateFunc,
+                         const std::string& outputName,
+                         const ga_config& config = ga_config{}); // Binary problems on packed genomes
+const void problemAMutate(std::vector<bit_genome>& population, size_t first, size_t last, double chance, ga_rng& rng); // Used for A, B, C
+const void problemDMutate(std::vector<std::string>& population, size_t first, size_t last, double chance, ga_rng& rng);
+const size_t problemAFitness(const bit_genome& g);
+const size_t problemBFitness(const bit_genome& g);
+const size_t problemCFitness(const bit_genome& g);
+const size_t problemDFitness(const std::string& s);
+
+// Problem policies
+// Each is a stateless type so the engine can call it directly and the compiler can inline it
+
+// Onemax, count of 1 bits
+struct problem_a_fitness {
+    typedef bit_genome genome_type;
+
+    size_t operator()(const bit_genome& g) const {
+        return popcount(g);
+    }
+
+    static size_t optimum(size_t length) { return length; }
+};
+
+// Evolve, count of bits matching a fixed target, repeated to cover genomes longer than the target
+struct problem_b_fitness {
+    typedef bit_genome genome_type;
+    static constexpr char target[] = "110110111011001010110101011010";
+    static constexpr size_t length = sizeof(target) - 1;
+    static constexpr uint64_t packedTarget = packBits(target, length);
+
+    size_t operator()(const bit_genome& g) const {
+        if (g.size() == length) {
+            return popcount64(~(g.words[0] ^ packedTarget) & g.tailMask());
+        }
+
+        thread_local bit_genome tiled;
+        if (tiled.size() != g.size()) {
+            tiled = tiledGenome(target, g.size());
+        }
+
+        return matchCount(g, tiled);
+    }
+
+    static size_t optimum(size_t length) { return length; }
+};
+
+// Landscape, onemax with a deceptive optimum at all 0's
+struct problem_c_fitness {
+    typedef bit_genome genome_type;
+
+    size_t operator()(const bit_genome& g) const {
+        const auto fitnessCounter = popcount(g);
+
+        if (fitnessCounter == 0) {
+            return 2 * g.size();
+        }
+
+        return fitnessCounter;
+    }
+
+    static size_t optimum(size_t length) { return 2 * length; }
+};
+
+// Evolve2, count of digits matching a fixed target, repeated to cover genomes longer than the target
+// Genomes are packed 4 bits per digit and compared against a packed copy of the target a vector at a time
+struct problem_d_fitness {
+    typedef nibble_genome genome_type;
+    static constexpr char target[] = "129384373440352123804353457823";
+    static constexpr size_t length = sizeof(target) - 1;
+
+    size_t operator()(const nibble_genome& g) const {
+        thread_local nibble_genome tiled;
+        if (tiled.size() != g.size()) {
+            tiled = tiledNibbleGenome(target, g.size());
+        }
+
+        return matchCount(g, tiled);
+    }
+
+    // Digit string form, kept for problemDFitness, compared one target length block at a time
+    size_t operator()(const std::string& s) const {
+        const auto data = s.data();
+        const auto blocks = s.length() / length;
+        size_t fitnessCounter{0};
+
+        for (size_t b = 0; b != blocks; b++) {
+            for (size_t i = 0; i != length; i++) { // Fixed trip count, unrolled and vectorised
+                fitnessCounter += data[b * length + i] == target[i];
+            }
+        }
+
+        for (size_t i = blocks * length; i != s.length(); i++) {
+            fitnessCounter += data[i] == target[i - blocks * length];
+        }
+
+        return fitnessCounter;
+    }
+
+    static size_t optimum(size_t length) { return length; }
+};
+
+// Used for A, B, C, flips one random bit of each individual with the given chance
+// Skips straight from one mutated individual to the next, so untouched individuals cost nothing
+struct problem_a_mutate {
+    void operator()(std::vector<bit_genome>& population, size_t first, size_t last, double chance, ga_rng& rng) const {
+        const auto logFail = std::log(1.0 - std::min(chance, 1.0));
+
+        for (auto i = first + std::min<uint64_t>(geometricSkip(rng, logFail), last - first); i < last; ) {
+            population[i].flip(uniformBelow(rng, population[i].size()));
+            i += 1 + std::min<uint64_t>(geometricSkip(rng, logFail), last - i);
+        }
+    }
+};
+
+// Replaces one random digit of each individual with the given chance
+struct problem_d_mutate {
+    void operator()(std::vector<nibble_genome>& population, size_t first, size_t last, double chance, ga_rng& rng) const {
+        const auto logFail = std::log(1.0 - std::min(chance, 1.0));
+
+        for (auto i = first + std::min<uint64_t>(geometricSkip(rng, logFail), last - first); i < last; ) {
+            population[i].set(uniformBelow(rng, population[i].size()), uniformBelow(rng, 10));
+            i += 1 + std::min<uint64_t>(geometricSkip(rng, logFail), last - i);
+        }
+    }
+
+    // Digit string form, kept for problemDMutate, writes digit characters so mutated digits can match the target
+    void operator()(std::vector<std::string>& population, size_t first, size_t last, double chance, ga_rng& rng) const {
+        const auto logFail = std::log(1.0 - std::min(chance, 1.0));
+
+        for (auto i = first + std::min<uint64_t>(geometricSkip(rng, logFail), last - first); i < last; ) {
+            population[i][uniformBelow(rng, population[i].size())] = '0' + uniformBelow(rng, 10);
+            i += 1 + std::min<uint64_t>(geometricSkip(rng, logFail), last - i);
+        }
+    }
+};
+
+// Digit strings are still supported through the std::function entry point, their individuals are decimal digits
+template <typename RNG>
+void randomize(std::string& s, RNG& rng) {
+    for (auto& c : s) {
+        c = '0' + uniformBelow(rng, 10);
+    }
+}
+
+// Writes into the offspring's existing storage rather than building substr temporaries
+inline void crossover(const std::string& a, const std::string& b, size_t bit, std::string& offspringA, std::string& offspringB) {
+    offspringA.assign(a, 0, bit).append(b, bit, std::string::npos);
+    offspringB.assign(b, 0, bit).append(a, bit, std::string::npos);
+}
+
+// Checkpoint storage for each genome type
+inline void save(checkpoint_writer& out, const std::string& s) { out.write(s); }
+inline void load(checkpoint_reader& in, std::string& s) { in.read(s); }
+
+inline void save(checkpoint_writer& out, const bit_genome& g) {
+    out.write(uint64_t{g.length});
+    out.write(g.words);
+}
+
+inline void load(checkpoint_reader& in, bit_genome& g) {
+    uint64_t length;
+    in.read(length);
+    in.read(g.words);
+    if (g.words.size() != (length + 63) / 64) in.fail("genome length does not match its words");
+    g.length = length;
+}
+
+inline void save(checkpoint_writer& out, const nibble_genome& g) {
+    out.write(uint64_t{g.length});
+    out.write(g.words);
+}
+
+inline void load(checkpoint_reader& in, nibble_genome& g) {
+    uint64_t length;
+    in.read(length);
+    in.read(g.words);
+    if (g.words.size() != (length + 15) / 16) in.fail("genome length does not match its words");
+    g.length = length;
+}
+
+// Shared GA loop for every genome type, Genome needs randomize(), crossover(), save() and load() overloads
+// Fitness evaluation and reproduction are split across threads, each worker has its own generator
+// seeded from mt so a run is reproducible for a fixed seed and thread count
+// The trace goes to outputName.txt or .bin through a background writer,
+// an empty outputName runs without writing a trace or printing a summary
+// The run ends early once config.stop is met, and with config.checkpointInterval set it snapshots the
+// population, every generator and the best so far to outputName.ckpt so config.resume can pick it up again
+// config.profile times each phase and writes the summary to outputName_profile.json
+// config.population must be even and at least 2, std::invalid_argument is thrown otherwise
+// config.adaptive counts the offspring fitter than the better of their parents and adjusts both rates from that
+// and the population's diversity, logging the rates used each generation to outputName_rates.txt
+template <typename Genome, typename Fitness, typename Mutate>
+const ga_result evolve(std::mt19937_64& mt, const Fitness& fitnessFunc, const Mutate& mutateFunc, const std::string& outputName, const ga_config& config) {
+    // Offspring are made in pairs that replace the whole population
+    if (config.population < 2 || config.population % 2 != 0) {
+        throw std::invalid_argument("population must be even and at least 2, not " + std::to_string(config.population));
+    }
+
+    std::vector<Genome> population(config.population), repopulation(config.population); // Population holds current generation, repop. holds the next one
+    std::vector<size_t> fitness(config.population), parents(config.population);
+    std::vector<size_t> parentBest(config.population); // Fitness of the better parent of each offspring, for the success rule
+    alias_table wheel;
+    tournament_selection tournament(config.tournamentSize);
+    const auto steadyState = config.selection == selection_mode::steady_state;
+    const auto steadyPairs = std::max<size_t>(1, (config.steadyStateOffspring + 1) / 2);
+    size_t totalFitness{0}, maxFitness{0}, generationMax{0}, generationMin{0};
+
+    thread_pool pool(config.threads);
+    std::vector<ga_rng> workerRng;
+    for (size_t w = 0; w != pool.size(); w++) {
+        workerRng.emplace_back(mt());
+    }
+
+    for (auto& g : population) {
+        g.resize(config.length);
+        randomize(g, mt);
+    }
+
+    convergence_monitor monitor(config.stop);
+    adaptive_rates rates(config.mutationChance, config.crossoverChance, 0.1, 0.5, 0.8, 1.0); // Only changed if config.adaptive
+    size_t successes{0}, trials{0};
+    size_t t{0};
+    bool finished{false};
+
+    // Checkpoint layout: shape of the run, progress, generators, then the population to evaluate next
+    const auto checkpointName = outputName.empty() ? std::string() : outputName + ".ckpt";
+    const auto saveCheckpoint = [&] {
+        checkpoint_writer out(checkpointName);
+        out.write(uint64_t{config.population});
+        out.write(uint64_t{config.length});
+        out.write(uint64_t{workerRng.size()});
+        out.write(uint64_t{t});
+        out.write(finished);
+        out.write(uint64_t{maxFitness});
+        out.write(uint64_t{monitor.stalled()});
+        out.write(monitor.elapsed());
+        rates.save(out);
+        out.write(uint64_t{successes});
+        out.write(uint64_t{trials});
+        out.write(parentBest);
+        out.write(mt);
+        for (const auto& rng : workerRng) out.write(rng);
+        for (const auto& g : population) save(out, g);
+        if (!out.commit()) std::cerr << "Failed to write " << checkpointName << std::endl;
+    };
+
+    if (config.resume && !checkpointName.empty()) {
+        checkpoint_reader in(checkpointName);
+        if (in.is_open()) {
+            uint64_t generation, best, stalled, succeeded, tried;
+            double elapsed;
+            in.expect(uint64_t{config.population}, "population");
+            in.expect(uint64_t{config.length}, "length");
+            in.expect(uint64_t{workerRng.size()}, "thread count");
+            in.read(generation);
+            in.read(finished);
+            in.read(best);
+            in.read(stalled);
+            in.read(elapsed);
+            rates.load(in);
+            in.read(succeeded);
+            in.read(tried);
+            in.read(parentBest);
+            if (parentBest.size() != config.population) in.fail("population does not match this run");
+            in.read(mt);
+            for (auto& rng : workerRng) in.read(rng);
+            for (auto& g : population) load(in, g);
+
+            t = generation, maxFitness = best, successes = succeeded, trials = tried;
+            monitor.restore(elapsed, stalled, best);
+        }
+    }
+
+    trace_writer outputData(outputName, config.trace, t);
+    outputData.capture(config.history);
+    rate_log rateLog(config.adaptive ? outputName : "", t);
+
+    ga_profile profile;
+    if (config.profile && !outputName.empty()) profile.enable(pool.size(), config.profileSamples, config.generations - std::min(t, config.generations));
+
+    // Parent choice for the generational modes
+    const auto select = [&](ga_rng& rng) {
+        return config.selection == selection_mode::roulette ? wheel.draw(rng) : tournament.draw(rng);
+    };
+
+    // A pair is crossed at a random point, or copied whole (point 0) if it misses the crossover chance
+    const auto crossoverPoint = [&](ga_rng& rng) -> size_t {
+        if (rates.crossover < 1.0 && uniformUnit(rng) >= rates.crossover) return 0;
+        return uniformBelow(rng, config.length);
+    };
+
+    // Steady state, a few pairs of offspring per generation each replace the loser of a reverse tournament
+    // if they are at least as fit, only the offspring are scored and fitness stays current for everyone else
+    // Replaced genomes are swapped with the offspring buffers, so nothing is copied or allocated
+    const auto steadyStateStep = [&] {
+        auto& rng = workerRng[0];
+        for (size_t pair = 0; pair != steadyPairs; pair++) {
+            {
+                const auto timer = profile.time(ga_phase::selection);
+                parents[0] = tournament.draw(rng), parents[1] = tournament.draw(rng);
+                profile.count(ga_counter::selection_draws, 2);
+            }
+            {
+                const auto timer = profile.time(ga_phase::crossover);
+                crossover(population[parents[0]], population[parents[1]], crossoverPoint(rng), repopulation[0], repopulation[1]);
+            }
+            {
+                const auto timer = profile.time(ga_phase::mutation);
+                mutateFunc(repopulation, 0, 2, rates.mutation, rng);
+            }
+
+            for (size_t child = 0; child != 2; child++) {
+                size_t childFitness;
+                {
+                    const auto timer = profile.time(ga_phase::fitness);
+                    childFitness = fitnessFunc(repopulation[child]);
+                    profile.count(ga_counter::fitness_calls, 1);
+                }
+
+                const auto timer = profile.time(ga_phase::selection);
+                const auto loser = tournament.drawWorst(rng);
+                successes += childFitness > std::max(fitness[parents[0]], fitness[parents[1]]);
+                trials++;
+                if (childFitness >= fitness[loser]) {
+                    std::swap(population[loser], repopulation[child]);
+                    fitness[loser] = childFitness;
+                }
+            }
+        }
+    };
+
+    // Run for T generations, or until the stopping criteria are met
+    const auto firstGeneration = t;
+    while (t < config.generations && !finished) {
+
+        // Every individual is scored exactly once per generation,
+        // in steady state only once at the start as offspring are scored when they are made
+        if (!steadyState || t == firstGeneration) {
+            parallelFor(pool, population.size(), [&](size_t w, size_t begin, size_t end) {
+                const auto timer = profile.time(ga_phase::fitness, w);
+                for (auto i = begin; i != end; i++) {
+                    fitness[i] = fitnessFunc(population[i]);
+                }
+                profile.count(ga_counter::fitness_calls, end - begin, w);
+            });
+        }
+
+        {
+            const auto timer = profile.time(ga_phase::output);
+            totalFitness = 0, generationMax = 0, generationMin = SIZE_MAX;
+            for (size_t i = 0; i != population.size(); i++) {
+                totalFitness += fitness[i];
+                generationMax = std::max(generationMax, fitness[i]);
+                generationMin = std::min(generationMin, fitness[i]);
+            }
+            maxFitness = std::max(maxFitness, generationMax);
+
+            outputData.record(t, static_cast<double>(totalFitness) / population.size(), generationMax, generationMin);
+
+            // Rates for this generation's offspring, from how the offspring scored just now did
+            if (config.adaptive) {
+                if (!steadyState && t != 0) {
+                    for (size_t i = 0; i != population.size(); i++) successes += fitness[i] > parentBest[i];
+                    trials += population.size();
+                }
+                rates.update(successes, trials, fitness);
+                successes = trials = 0;
+                rateLog.record(t, rates.mutation, rates.crossover);
+            }
+        }
+        t++;
+
+        if (monitor.converged(maxFitness)) break;
+
+        {
+            const auto timer = profile.time(ga_phase::selection);
+            if (config.selection == selection_mode::roulette) {
+                wheel.build(fitness);
+            } else {
+                tournament.build(fitness);
+            }
+        }
+
+        if (steadyState) {
+            steadyStateStep();
+        } else {
+            // Reproduction
+            // Each pair of offspring is independent, a worker picks the parents of its block of the next generation,
+            // crosses them over and mutates the result
+            parallelFor(pool, population.size() / 2, [&](size_t w, size_t begin, size_t end) {
+                auto& rng = workerRng[w];
+
+                {
+                    const auto timer = profile.time(ga_phase::selection, w);
+                    for (auto pair = begin; pair != end; pair++) {
+                        parents[2 * pair] = select(rng), parents[2 * pair + 1] = select(rng);
+                    }
+                    profile.count(ga_counter::selection_draws, 2 * (end - begin), w);
+                }
+
+                {
+                    const auto timer = profile.time(ga_phase::crossover, w);
+                    for (auto pair = begin; pair != end; pair++) {
+                        crossover(population[parents[2 * pair]], population[parents[2 * pair + 1]], crossoverPoint(rng),
+                                  repopulation[2 * pair], repopulation[2 * pair + 1]);
+                        parentBest[2 * pair] = parentBest[2 * pair + 1] = std::max(fitness[parents[2 * pair]], fitness[parents[2 * pair + 1]]);
+                    }
+                }
+
+                // Mutation
+                const auto timer = profile.time(ga_phase::mutation, w);
+                mutateFunc(repopulation, 2 * begin, 2 * end, rates.mutation, rng);
+            });
+
+            population.swap(repopulation);
+        }
+
+        if (config.checkpointInterval != 0 && !checkpointName.empty() && t % config.checkpointInterval == 0) {
+            const auto timer = profile.time(ga_phase::output);
+            outputData.flush();
+            rateLog.flush();
+            saveCheckpoint();
+        }
+
+        profile.endGeneration(t - 1);
+    }
+
+    // A finished checkpoint lets a resumed multi-problem run skip straight past this problem
+    finished = true;
+    if (config.checkpointInterval != 0 && !checkpointName.empty()) saveCheckpoint();
+
+    if (!outputName.empty()) {
+        outputData.close();
+        if (!profile.writeJson(outputName + "_profile.json", outputName, t)) std::cerr << "Failed to write " << outputName << "_profile.json" << std::endl;
+        std::cout << outputName << " finished after " << t << " generations. Max fitness: " << maxFitness;
+        if (config.adaptive) std::cout << " (mutation " << rates.mutation << ", crossover " << rates.crossover << ")";
+        std::cout << std::endl;
+    }
+
+    const auto evaluations = steadyState ? population.size() + (t == 0 ? 0 : t - 1) * 2 * steadyPairs : t * population.size();
+    return {maxFitness, t, evaluations, rates.mutation, rates.crossover};
+}
+
+// Compile-time specialised entry point, e.g. processProblem<problem_a_fitness, problem_a_mutate>(mt, "Onemax")
+// Fitness and Mutate are policy types, their calls resolve statically instead of through std::function
+template <typename Fitness, typename Mutate, typename Genome = typename Fitness::genome_type>
+const ga_result processProblem(std::mt19937_64& mt, const std::string& outputName, const ga_config& config = ga_config{}) {
+    if (config.stopAtOptimum) {
+        auto solved = config;
+        solved.stop.targetFitness = Fitness::optimum(config.length);
+        return evolve<Genome>(mt, Fitness{}, Mutate{}, outputName, solved);
+    }
+
+    return evolve<Genome>(mt, Fitness{}, Mutate{}, outputName, config);
+}
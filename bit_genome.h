@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <random>
+
+// A genome of single bits packed 64 to a word, bit i lives at position (i % 64) of words[i / 64]
+// Bits past length in the last word are always kept at 0 so whole-word popcounts stay exact
+struct bit_genome {
+    std::vector<uint64_t> words;
+    size_t length{0};
+
+    bit_genome() = default;
+    explicit bit_genome(size_t length) : words((length + 63) / 64, 0), length(length) {}
+
+    size_t size() const { return length; }
+    bool get(size_t i) const { return (words[i / 64] >> (i % 64)) & 1u; }
+    void flip(size_t i) { words[i / 64] ^= uint64_t{1} << (i % 64); }
+
+    // Mask of the valid bits in the last word
+    uint64_t tailMask() const {
+        return (length % 64 == 0) ? ~uint64_t{0} : (uint64_t{1} << (length % 64)) - 1;
+    }
+
+    void resize(size_t newLength) {
+        length = newLength;
+        words.resize((length + 63) / 64);
+    }
+};
+
+// Compiles to a single popcnt instruction when built with -mpopcnt or -march=native
+inline size_t popcount64(uint64_t w) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(w);
+#else
+    w = w - ((w >> 1) & 0x5555555555555555ull);
+    w = (w & 0x3333333333333333ull) + ((w >> 2) & 0x3333333333333333ull);
+    w = (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return (w * 0x0101010101010101ull) >> 56;
+#endif
+}
+
+// Number of 1 bits in the genome
+inline size_t popcount(const bit_genome& g) {
+    size_t count{0};
+    for (const auto w : g.words) count += popcount64(w);
+    return count;
+}
+
+// Number of positions where g and target agree, XNOR then popcount word by word
+// The tail of the last word is masked off as XNOR turns the padding zeros into ones
+inline size_t matchCount(const bit_genome& g, const bit_genome& target) {
+    const auto n = g.words.size();
+    if (n == 0) return 0;
+
+    size_t count{0};
+    for (size_t i = 0; i + 1 < n; i++) {
+        count += popcount64(~(g.words[i] ^ target.words[i]));
+    }
+    count += popcount64(~(g.words[n - 1] ^ target.words[n - 1]) & g.tailMask());
+
+    return count;
+}
+
+// Single point crossover, offspringA takes bits [0, bit) from a and [bit, length) from b, offspringB the reverse
+// Whole words are copied and only the word holding the crossover point is merged through a mask,
+// offspring storage is reused so no allocation happens once they are sized
+inline void crossover(const bit_genome& a, const bit_genome& b, size_t bit,
+                      bit_genome& offspringA, bit_genome& offspringB) {
+    const auto n = a.words.size();
+    const auto split = bit / 64;
+    offspringA.resize(a.length);
+    offspringB.resize(a.length);
+
+    for (size_t i = 0; i != split && i != n; i++) {
+        offspringA.words[i] = a.words[i];
+        offspringB.words[i] = b.words[i];
+    }
+
+    if (split < n) {
+        const uint64_t low = (uint64_t{1} << (bit % 64)) - 1; // Bits below the crossover point
+        offspringA.words[split] = (a.words[split] & low) | (b.words[split] & ~low);
+        offspringB.words[split] = (b.words[split] & low) | (a.words[split] & ~low);
+    }
+
+    for (size_t i = split + 1; i < n; i++) {
+        offspringA.words[i] = b.words[i];
+        offspringB.words[i] = a.words[i];
+    }
+}
+
+// Fills the genome with uniformly random bits, 64 at a time
+template <typename RNG>
+void randomize(bit_genome& g, RNG& rng) {
+    for (auto& w : g.words) w = rng();
+    if (!g.words.empty()) g.words.back() &= g.tailMask();
+}
+
+// Repeats pattern until length bits are filled, used to stretch fixed targets to longer genomes
+inline bit_genome tiledGenome(const std::string& pattern, size_t length) {
+    bit_genome g(length);
+    for (size_t i = 0; i != length; i++) {
+        if (pattern[i % pattern.length()] == '1') g.words[i / 64] |= uint64_t{1} << (i % 64);
+    }
+    return g;
+}
+
+// Packs up to 64 '0'/'1' characters into one word at compile time, bit i is bits[i]
+constexpr uint64_t packBits(const char* bits, size_t n) {
+    uint64_t w{0};
+    for (size_t i = 0; i != n && i != 64; i++) {
+        if (bits[i] == '1') w |= uint64_t{1} << i;
+    }
+    return w;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "ga_checkpoint.h"
+#include "ga_trace.h"
+
+// Online control of the mutation and crossover rates, updated once a generation from what the last one achieved
+// Mutation follows the 1/5th success rule: if more than a fifth of offspring beat their parents the rate grows,
+// if fewer it shrinks, and the two steps are sized so the rate holds still at exactly one in five
+// A population whose fitness values have collapsed onto a few is on a plateau, its mutation rate is boosted on top
+// Crossover is set from the same diversity, moving from lowDiversityCrossover to highDiversityCrossover as it rises
+struct adaptive_rates {
+    static constexpr double SUCCESS_TARGET = 0.2;
+    static constexpr double GROWTH = 1.5; // Mutation rate step after a successful generation
+    static constexpr double BOOST = 1.5; // Extra mutation rate step while diversity is below DIVERSITY_FLOOR
+    static constexpr double DIVERSITY_FLOOR = 0.2;
+    static constexpr double DIVERSITY_TARGET = 0.5; // Diversity at which crossover reaches highDiversityCrossover
+
+    double mutation{0}, crossover{0}; // Rates in use
+    double minMutation{0}, maxMutation{1};
+    double lowDiversityCrossover{0}, highDiversityCrossover{0};
+
+    adaptive_rates(double mutation, double crossover, double minMutation, double maxMutation,
+                   double lowDiversityCrossover, double highDiversityCrossover)
+        : mutation(mutation), crossover(crossover), minMutation(minMutation), maxMutation(maxMutation),
+          lowDiversityCrossover(lowDiversityCrossover), highDiversityCrossover(highDiversityCrossover) {}
+
+    // successes of trials offspring beat their parents in the generation just scored, whose fitness is given
+    void update(size_t successes, size_t trials, const std::vector<size_t>& fitness) {
+        if (trials != 0) {
+            const auto ratio = static_cast<double>(successes) / trials;
+            if (ratio > SUCCESS_TARGET) mutation *= GROWTH;
+            else if (ratio < SUCCESS_TARGET) mutation /= std::pow(GROWTH, SUCCESS_TARGET / (1 - SUCCESS_TARGET));
+        }
+
+        const auto spread = diversity(fitness);
+        if (spread < DIVERSITY_FLOOR) mutation *= BOOST;
+        mutation = std::min(maxMutation, std::max(minMutation, mutation));
+        crossover = lowDiversityCrossover + (highDiversityCrossover - lowDiversityCrossover) * std::min(1.0, spread / DIVERSITY_TARGET);
+    }
+
+    // Share of distinct fitness values, 0 when every individual scores the same and 1 when no two do
+    double diversity(const std::vector<size_t>& fitness) {
+        if (fitness.size() < 2) return 1;
+
+        sorted.assign(fitness.begin(), fitness.end()); // Storage is reused, so this allocates once
+        std::sort(sorted.begin(), sorted.end());
+        const auto distinct = std::unique(sorted.begin(), sorted.end()) - sorted.begin();
+        return static_cast<double>(distinct - 1) / (fitness.size() - 1);
+    }
+
+    void save(checkpoint_writer& out) const {
+        out.write(mutation);
+        out.write(crossover);
+    }
+
+    void load(checkpoint_reader& in) {
+        in.read(mutation);
+        in.read(crossover);
+    }
+
+private:
+    std::vector<size_t> sorted;
+};
+
+// The rates an adaptive run used, one "generation mutation crossover" line per generation in outputName_rates.txt
+// Lines are collected in memory and written a block at a time, flush() before a checkpoint as with trace_writer
+// An empty outputName leaves the log closed and record() does nothing
+class rate_log {
+public:
+    static constexpr size_t BLOCK_BYTES = 1 << 16;
+
+    rate_log(const std::string& outputName, size_t keepRecords = 0) {
+        if (outputName.empty()) return;
+
+        const auto filename = outputName + "_rates.txt";
+        if (keepRecords != 0) trace_writer::truncate(filename, keepRecords);
+        out.open(filename, keepRecords == 0 ? std::ios::trunc : std::ios::app);
+    }
+
+    ~rate_log() { flush(); }
+
+    void record(uint64_t generation, double mutation, double crossover) {
+        if (!out.is_open()) return;
+
+        text += std::to_string(generation);
+        text += ' ';
+        text += std::to_string(mutation);
+        text += ' ';
+        text += std::to_string(crossover);
+        text += '\n';
+        if (text.size() >= BLOCK_BYTES) flush();
+    }
+
+    void flush() {
+        if (!out.is_open()) return;
+
+        out.write(text.data(), text.size());
+        out.flush();
+        text.clear();
+    }
+
+private:
+    std::ofstream out;
+    std::string text;
+};
@@ -0,0 +1,172 @@
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "ai.h"
+#include "a1_csv.h"
+#include "a1_ga.h"
+#include "a1_flow.h"
+
+using namespace std;
+
+// Benchmarks both GAs over a sweep of run parameters and writes one CSV row per run to stdout
+// Every list option takes comma separated values and all combinations are run
+//
+// Usage: ga_bench [--population 10,100] [--length 30,1000] [--generations 1000] [--threads 1,4]
+//                 [--alloc-population 20] [--crossover 0.6] [--mutation 0.4] [--alloc-generations 10000]
+//                 [--local-search 0] [--students Student-choices.csv] [--supervisors Supervisors.csv] [--seed 1]
+//
+// Each run happens in its own forked process so peak RSS belongs to that run alone
+// The exact allocation optimum is also timed once, so best_fitness of the GA rows can be compared against it
+
+struct bench_row {
+    string program, problem;
+    size_t population, length, generations, threads;
+    double crossover, mutation;
+};
+
+template <typename T>
+const vector<T> parseList(const string& value) {
+    vector<T> values;
+    stringstream ss(value);
+    string token;
+
+    while (getline(ss, token, ',')) {
+        T v;
+        stringstream(token) >> v;
+        values.push_back(v);
+    }
+
+    return values;
+}
+
+// Runs run() in a child process, then prints the row with its timings and the child's peak RSS
+// run() returns {evaluations, best fitness}
+void measure(const bench_row& row, const function<pair<size_t, size_t>()>& run) {
+    cout.flush();
+    const auto pid = fork();
+
+    if (pid == 0) {
+        const auto start = chrono::steady_clock::now();
+        const auto evaluations = run();
+        const chrono::duration<double> wall = chrono::steady_clock::now() - start;
+
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+
+        cout << row.program << "," << row.problem << "," << row.population << "," << row.length << ","
+             << row.generations << "," << row.threads << "," << row.crossover << "," << row.mutation << ","
+             << wall.count() << "," << (row.generations / wall.count()) << "," << (evaluations.first / wall.count()) << ","
+             << usage.ru_maxrss << "," << evaluations.second << "\n";
+        cout.flush();
+        _exit(0);
+    }
+
+    int status{0};
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        cerr << row.program << " " << row.problem << " run failed" << endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    map<string, string> options{
+        {"--population", to_string(INITIAL_POPULATION)},
+        {"--length", to_string(STRING_LENGTH)},
+        {"--generations", to_string(GENERATIONS)},
+        {"--threads", "1"},
+        {"--alloc-population", to_string(alloc_config{}.population)},
+        {"--crossover", to_string(alloc_config{}.crossoverFraction)},
+        {"--mutation", to_string(alloc_config{}.mutationRate)},
+        {"--alloc-generations", to_string(alloc_config{}.generations)},
+        {"--local-search", "0"},
+        {"--students", "Student-choices.csv"},
+        {"--supervisors", "Supervisors.csv"},
+        {"--seed", "1"},
+    };
+
+    for (auto i = 1; i + 1 < argc; i += 2) {
+        if (options.count(argv[i]) == 0) {
+            cerr << "Unknown option " << argv[i] << endl;
+            return 1;
+        }
+        options[argv[i]] = argv[i + 1];
+    }
+
+    const auto seed = stoull(options["--seed"]);
+
+    cout << "program,problem,population,length,generations,threads,crossover,mutation,"
+         << "wall_seconds,generations_per_second,evaluations_per_second,peak_rss_kb,best_fitness\n";
+
+    for (const auto population : parseList<size_t>(options["--population"])) {
+        if (population < 2 || population % 2 != 0) {
+            cerr << "Skipping population " << population << ", it must be even and at least 2" << endl;
+            continue;
+        }
+
+        for (const auto length : parseList<size_t>(options["--length"])) {
+            for (const auto generations : parseList<size_t>(options["--generations"])) {
+                for (const auto threads : parseList<size_t>(options["--threads"])) {
+                    ga_config config;
+                    config.population = population;
+                    config.length = length;
+                    config.generations = generations;
+                    config.threads = threads;
+
+                    const auto run = [&](const string& problem, const function<ga_result(mt19937_64&)>& process) {
+                        measure({"ai", problem, population, length, generations, threads, 0, 0}, [&] {
+                            mt19937_64 mt(seed);
+                            const auto result = process(mt);
+                            return make_pair(result.evaluations, result.maxFitness);
+                        });
+                    };
+
+                    run("Onemax", [&](mt19937_64& mt) { return processProblem<problem_a_fitness, problem_a_mutate>(mt, "", config); });
+                    run("Evolve", [&](mt19937_64& mt) { return processProblem<problem_b_fitness, problem_a_mutate>(mt, "", config); });
+                    run("Landscape", [&](mt19937_64& mt) { return processProblem<problem_c_fitness, problem_a_mutate>(mt, "", config); });
+                    run("Evolve2", [&](mt19937_64& mt) { return processProblem<problem_d_fitness, problem_d_mutate>(mt, "", config); });
+                }
+            }
+        }
+    }
+
+    const auto supervisors = parseSupervisorsCsv(options["--supervisors"]);
+    const auto students = parseStudentsCsv(options["--students"], supervisors);
+    const auto preferences = buildPreferenceMatrix(students, supervisors);
+
+    for (const auto population : parseList<size_t>(options["--alloc-population"])) {
+        for (const auto crossover : parseList<double>(options["--crossover"])) {
+            for (const auto mutation : parseList<double>(options["--mutation"])) {
+                for (const auto generations : parseList<size_t>(options["--alloc-generations"])) {
+                    for (const auto localSearch : parseList<size_t>(options["--local-search"])) {
+                        alloc_config config;
+                        config.population = population;
+                        config.crossoverFraction = crossover;
+                        config.mutationRate = mutation;
+                        config.generations = generations;
+                        config.localSearchMoves = localSearch;
+
+                        measure({"a1_b", localSearch == 0 ? "Allocation" : "Memetic", population, students.size(), generations, 1, crossover, mutation}, [&] {
+                            mt19937_64 mt(seed);
+                            const auto result = evolveAllocation(preferences, supervisors, mt, config, "");
+                            return make_pair(result.evaluations, result.bestFitness);
+                        });
+                    }
+                }
+            }
+        }
+    }
+
+    measure({"a1_b", "Exact", 0, students.size(), 0, 1, 0, 0}, [&] {
+        return make_pair(size_t{0}, solveAllocation(preferences, supervisors).bestFitness);
+    });
+
+    return 0;
+}
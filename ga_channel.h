@@ -0,0 +1,46 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded single-producer single-consumer ring of fixed-width records, used to pass migrants between islands
+// Each record is width values of T plus a fitness, all storage is allocated up front and neither
+// side ever blocks or takes a lock, a push into a full ring simply fails
+template <typename T>
+class migration_ring {
+public:
+    migration_ring(size_t capacity, size_t width)
+        : capacity(capacity + 1), width(width), records((capacity + 1) * width), fitness(capacity + 1) {}
+
+    // Producer side, false if the ring is full
+    bool tryPush(const T* record, size_t recordFitness) {
+        const auto h = head.load(std::memory_order_relaxed);
+        const auto next = (h + 1) % capacity;
+        if (next == tail.load(std::memory_order_acquire)) return false;
+
+        std::copy(record, record + width, records.data() + h * width);
+        fitness[h] = recordFitness;
+        head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side, false if the ring is empty
+    bool tryPop(T* record, size_t& recordFitness) {
+        const auto t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+
+        std::copy(records.data() + t * width, records.data() + (t + 1) * width, record);
+        recordFitness = fitness[t];
+        tail.store((t + 1) % capacity, std::memory_order_release);
+        return true;
+    }
+
+private:
+    const size_t capacity, width;
+    std::vector<T> records;
+    std::vector<size_t> fitness;
+    alignas(64) std::atomic<size_t> head{0}; // Written only by the producer
+    alignas(64) std::atomic<size_t> tail{0}; // Written only by the consumer
+};
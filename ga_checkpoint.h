@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Binary snapshot of a run, values are written in native byte order behind a short magic header
+// The snapshot goes to filename.tmp first and is renamed over filename by commit(),
+// so a run killed mid-write still leaves the previous checkpoint intact
+class checkpoint_writer {
+public:
+    explicit checkpoint_writer(const std::string& filename) : filename(filename), out(filename + ".tmp", std::ios::binary) {
+        out.write(MAGIC, sizeof(MAGIC));
+    }
+
+    template <typename T>
+    void write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain values are written as raw bytes");
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    void write(const std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain values are written as raw bytes");
+        write(uint64_t{values.size()});
+        out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    void write(const std::string& value) {
+        write(uint64_t{value.size()});
+        out.write(value.data(), value.size());
+    }
+
+    // Generators are stored in their standard text form, which round-trips the full state
+    void write(const std::mt19937_64& mt) {
+        std::ostringstream state;
+        state << mt;
+        write(state.str());
+    }
+
+    // Replaces the previous checkpoint, false if anything failed to write
+    bool commit() {
+        out.close();
+        if (!out) return false;
+        return std::rename((filename + ".tmp").c_str(), filename.c_str()) == 0;
+    }
+
+    static constexpr char MAGIC[8] = {'G', 'A', 'C', 'K', 'P', 'T', '0', '3'};
+
+private:
+    const std::string filename;
+    std::ofstream out;
+};
+
+// Reads back what checkpoint_writer wrote, in the same order
+// A missing file leaves the reader closed, a damaged or truncated one throws std::runtime_error
+class checkpoint_reader {
+public:
+    explicit checkpoint_reader(const std::string& filename) : filename(filename), in(filename, std::ios::binary) {
+        if (!in) return;
+
+        char magic[sizeof(checkpoint_writer::MAGIC)];
+        in.read(magic, sizeof(magic));
+        if (!in || !std::equal(magic, magic + sizeof(magic), checkpoint_writer::MAGIC)) fail("not a checkpoint");
+    }
+
+    bool is_open() const { return in.is_open(); }
+
+    template <typename T>
+    void read(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain values are read as raw bytes");
+        in.read(reinterpret_cast<char*>(&value), sizeof(T));
+        if (!in) fail("truncated");
+    }
+
+    template <typename T>
+    void read(std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain values are read as raw bytes");
+        values.resize(readSize());
+        in.read(reinterpret_cast<char*>(values.data()), values.size() * sizeof(T));
+        if (!in) fail("truncated");
+    }
+
+    void read(std::string& value) {
+        value.resize(readSize());
+        in.read(&value[0], value.size());
+        if (!in) fail("truncated");
+    }
+
+    void read(std::mt19937_64& mt) {
+        std::string text;
+        read(text);
+        std::istringstream state(text);
+        state >> mt;
+        if (!state) fail("bad generator state");
+    }
+
+    // Reads a value that must equal expected, e.g. a population size the run depends on
+    template <typename T>
+    void expect(const T& expected, const char* what) {
+        T value;
+        read(value);
+        if (value != expected) fail(std::string(what) + " does not match this run");
+    }
+
+    [[noreturn]] void fail(const std::string& message) const {
+        throw std::runtime_error(filename + ": " + message);
+    }
+
+private:
+    size_t readSize() {
+        uint64_t size;
+        read(size);
+        if (size > (uint64_t{1} << 40)) fail("implausible length");
+        return size;
+    }
+
+    const std::string filename;
+    std::ifstream in;
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that all run the same task and then wait for the next one
+// The calling thread takes part as worker 0, so a pool of 1 runs everything inline with no threads
+class thread_pool {
+public:
+    explicit thread_pool(size_t threads) : count(threads == 0 ? 1 : threads) {
+        for (size_t w = 1; w < count; w++) {
+            workers.emplace_back([this, w] { workerLoop(w); });
+        }
+    }
+
+    ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            stopping = true;
+            epoch++;
+        }
+        wake.notify_all();
+        for (auto& t : workers) t.join();
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    size_t size() const { return count; }
+
+    // Runs task(worker) once on every worker and returns when all of them are done
+    void run(const std::function<void(size_t)>& task) {
+        if (count == 1) {
+            task(0);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m);
+            current = &task;
+            pending = count - 1;
+            epoch++;
+        }
+        wake.notify_all();
+
+        task(0);
+
+        std::unique_lock<std::mutex> lock(m);
+        done.wait(lock, [this] { return pending == 0; });
+        current = nullptr;
+    }
+
+private:
+    void workerLoop(size_t w) {
+        size_t seen{0};
+        for (;;) {
+            const std::function<void(size_t)>* task;
+            {
+                std::unique_lock<std::mutex> lock(m);
+                wake.wait(lock, [&] { return epoch != seen; });
+                seen = epoch;
+                if (stopping) return;
+                task = current;
+            }
+
+            (*task)(w);
+
+            {
+                std::lock_guard<std::mutex> lock(m);
+                pending--;
+            }
+            done.notify_one();
+        }
+    }
+
+    size_t count;
+    std::vector<std::thread> workers;
+    std::mutex m;
+    std::condition_variable wake, done;
+    const std::function<void(size_t)>* current{nullptr};
+    size_t pending{0}, epoch{0};
+    bool stopping{false};
+};
+
+// Splits [0, n) into one contiguous block per worker and calls f(worker, begin, end)
+// Blocks depend only on n and the pool size, so work assignment is the same on every run
+template <typename F>
+void parallelFor(thread_pool& pool, size_t n, const F& f) {
+    const auto threads = pool.size();
+    pool.run([&](size_t w) {
+        const auto begin = n * w / threads, end = n * (w + 1) / threads;
+        if (begin != end) f(w, begin, end);
+    });
+}
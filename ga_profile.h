@@ -0,0 +1,166 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+
+// Phases of a generation and the events counted alongside them
+enum class ga_phase { fitness, selection, crossover, mutation, local_search, output, count };
+enum class ga_counter { fitness_calls, selection_draws, allocations, local_search_moves, count };
+
+constexpr size_t GA_PHASES = static_cast<size_t>(ga_phase::count);
+constexpr size_t GA_COUNTERS = static_cast<size_t>(ga_counter::count);
+
+// Heap allocations made by the whole program, only counted in programs that define GA_COUNT_ALLOCATIONS
+// before including this header, which replaces the global operator new in that one translation unit
+inline std::atomic<uint64_t> gaAllocations{0};
+
+#ifdef GA_COUNT_ALLOCATIONS
+void* operator new(std::size_t size) {
+    gaAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (const auto p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+
+// Kept out of line so GCC does not pair the inlined free() with new and warn about a mismatch
+__attribute__((noinline)) void operator delete(void* p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+#endif
+
+// Adds the time from construction to destruction onto a phase total, does nothing without a target
+class phase_timer {
+public:
+    explicit phase_timer(uint64_t* target) : target(target) {
+        if (target != nullptr) start = std::chrono::steady_clock::now();
+    }
+
+    ~phase_timer() {
+        if (target != nullptr) *target += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    phase_timer(const phase_timer&) = delete;
+    phase_timer& operator=(const phase_timer&) = delete;
+
+private:
+    uint64_t* const target;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Per-phase time and event counts for one run, written out as JSON at the end
+// Disabled by default, then every call is a single branch and no clock is read
+// Each worker thread adds into its own cache line, so phase times are summed over threads
+// and can exceed the wall time of a multithreaded run
+class ga_profile {
+public:
+    // Samples are reserved for the expected generation count up front so keeping them does not show up as allocations
+    void enable(size_t workers, bool keepSamples, size_t generations) {
+        slots.assign(workers == 0 ? 1 : workers, worker_slot{});
+        samples = keepSamples;
+        if (samples) generationSamples.reserve(generations);
+        on = true;
+        start = std::chrono::steady_clock::now();
+        allocationsAtStart = gaAllocations.load(std::memory_order_relaxed);
+        previous = totals();
+    }
+
+    bool enabled() const { return on; }
+
+    phase_timer time(ga_phase phase, size_t worker = 0) {
+        return phase_timer(on ? &slots[worker].ns[static_cast<size_t>(phase)] : nullptr);
+    }
+
+    void count(ga_counter counter, uint64_t n, size_t worker = 0) {
+        if (on) slots[worker].counts[static_cast<size_t>(counter)] += n;
+    }
+
+    // Closes generation t, keeping what it alone cost if samples were asked for
+    void endGeneration(size_t t) {
+        if (!on || !samples) return;
+
+        const auto now = totals();
+        sample s{t, {}};
+        for (size_t i = 0; i != s.values.size(); i++) s.values[i] = now[i] - previous[i];
+        generationSamples.push_back(s);
+        previous = now;
+    }
+
+    // Writes the summary, and the samples if kept, for a run called name
+    bool writeJson(const std::string& filename, const std::string& name, size_t generations) const {
+        if (!on) return true;
+
+        const auto total = totals();
+        const auto wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::string json;
+
+        json += "{\n  \"run\": \"" + name + "\",\n";
+        json += "  \"generations\": " + std::to_string(generations) + ",\n";
+        json += "  \"threads\": " + std::to_string(slots.size()) + ",\n";
+        json += "  \"wall_seconds\": " + std::to_string(wall) + ",\n";
+        json += "  \"phases\": {";
+        for (size_t p = 0; p != GA_PHASES; p++) {
+            json += std::string(p == 0 ? "\n" : ",\n") + "    \"" + PHASE_NAMES[p] + "\": " + std::to_string(total[p] * 1e-9);
+        }
+        json += "\n  },\n  \"counters\": {";
+        for (size_t c = 0; c != GA_COUNTERS; c++) {
+            json += std::string(c == 0 ? "\n" : ",\n") + "    \"" + COUNTER_NAMES[c] + "\": " + std::to_string(total[GA_PHASES + c]);
+        }
+        json += "\n  }";
+
+        if (samples) {
+            json += ",\n  \"samples\": [";
+            for (size_t i = 0; i != generationSamples.size(); i++) {
+                const auto& s = generationSamples[i];
+                json += std::string(i == 0 ? "\n" : ",\n") + "    {\"generation\": " + std::to_string(s.generation);
+                for (size_t p = 0; p != GA_PHASES; p++) json += ", \"" + std::string(PHASE_NAMES[p]) + "_ns\": " + std::to_string(s.values[p]);
+                for (size_t c = 0; c != GA_COUNTERS; c++) json += ", \"" + std::string(COUNTER_NAMES[c]) + "\": " + std::to_string(s.values[GA_PHASES + c]);
+                json += "}";
+            }
+            json += "\n  ]";
+        }
+        json += "\n}\n";
+
+        std::ofstream out(filename);
+        out.write(json.data(), json.size());
+        return static_cast<bool>(out);
+    }
+
+    static constexpr const char* PHASE_NAMES[GA_PHASES] = {"fitness", "selection", "crossover", "mutation", "local_search", "output"};
+    static constexpr const char* COUNTER_NAMES[GA_COUNTERS] = {"fitness_calls", "selection_draws", "allocations", "local_search_moves"};
+
+private:
+    struct alignas(64) worker_slot {
+        std::array<uint64_t, GA_PHASES> ns{};
+        std::array<uint64_t, GA_COUNTERS> counts{};
+    };
+
+    typedef std::array<uint64_t, GA_PHASES + GA_COUNTERS> totals_type;
+
+    struct sample {
+        size_t generation;
+        totals_type values;
+    };
+
+    // Phase nanoseconds then counters, summed over workers, allocations are program wide
+    totals_type totals() const {
+        totals_type sum{};
+        for (const auto& slot : slots) {
+            for (size_t p = 0; p != GA_PHASES; p++) sum[p] += slot.ns[p];
+            for (size_t c = 0; c != GA_COUNTERS; c++) sum[GA_PHASES + c] += slot.counts[c];
+        }
+        sum[GA_PHASES + static_cast<size_t>(ga_counter::allocations)] = gaAllocations.load(std::memory_order_relaxed) - allocationsAtStart;
+        return sum;
+    }
+
+    std::vector<worker_slot> slots;
+    std::vector<sample> generationSamples;
+    totals_type previous{};
+    std::chrono::steady_clock::time_point start;
+    uint64_t allocationsAtStart{0};
+    bool on{false}, samples{false};
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+// Random number layer for the GA operators
+// Operators take any 64-bit generator and draw through the helpers below instead of constructing
+// std distributions, the engines here are xoshiro256** streams refilled a batch at a time
+
+// Uniform integer in [0, n), n > 0, by Lemire's multiply-shift with rejection so it stays unbiased
+// Usually one generator call and no division
+template <typename RNG>
+inline uint64_t uniformBelow(RNG& rng, uint64_t n) {
+    static_assert(RNG::min() == 0 && RNG::max() == UINT64_MAX, "needs a full 64-bit generator");
+
+    auto m = static_cast<unsigned __int128>(rng()) * n;
+    if (static_cast<uint64_t>(m) < n) {
+        const auto threshold = (0 - n) % n;
+        while (static_cast<uint64_t>(m) < threshold) {
+            m = static_cast<unsigned __int128>(rng()) * n;
+        }
+    }
+
+    return static_cast<uint64_t>(m >> 64);
+}
+
+// Uniform double in [0, 1) from the top 53 bits
+template <typename RNG>
+inline double uniformUnit(RNG& rng) {
+    return (rng() >> 11) * 0x1.0p-53;
+}
+
+// Failures before the next success of a Bernoulli(p) trial, logFail is log(1 - p)
+// Lets an operator jump straight to the next individual or gene it touches, so the work done
+// is proportional to the number of mutations rather than the number of candidates
+template <typename RNG>
+inline uint64_t geometricSkip(RNG& rng, double logFail) {
+    if (logFail == 0) return UINT64_MAX; // p == 0, nothing is ever hit
+
+    const auto skip = std::floor(std::log(1.0 - uniformUnit(rng)) / logFail); // 1 - u is in (0, 1]
+    return skip >= 1e18 ? UINT64_MAX : static_cast<uint64_t>(skip);
+}
+
+// splitmix64, expands one seed into well mixed engine state
+inline uint64_t splitMix64(uint64_t& state) {
+    auto z = (state += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+// xoshiro256** (Blackman and Vigna), LANES independent streams advanced in lockstep
+// The state is stored lane-minor so a refill is straight-line code over LANES elements
+// that the compiler turns into vector instructions
+class xoshiro256ss_lanes {
+public:
+    static constexpr size_t LANES = 4;
+
+    explicit xoshiro256ss_lanes(uint64_t seed = 0) {
+        for (auto& word : s) {
+            for (auto& lane : word) lane = splitMix64(seed);
+        }
+    }
+
+    // Writes n outputs, n must be a multiple of LANES
+    void fill(uint64_t* out, size_t n) {
+        for (size_t i = 0; i != n; i += LANES) {
+            for (size_t l = 0; l != LANES; l++) {
+                out[i + l] = rotl(s[1][l] * 5, 7) * 9;
+
+                const auto t = s[1][l] << 17;
+                s[2][l] ^= s[0][l];
+                s[3][l] ^= s[1][l];
+                s[1][l] ^= s[2][l];
+                s[0][l] ^= s[3][l];
+                s[2][l] ^= t;
+                s[3][l] = rotl(s[3][l], 45);
+            }
+        }
+    }
+
+private:
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    uint64_t s[4][LANES];
+};
+
+// Buffered generator, a standard UniformRandomBitGenerator that hands out BATCH outputs of Engine
+// before refilling, so the per-call cost is a load and a compare
+// Plain data, so it can be copied into a checkpoint as raw bytes
+template <typename Engine, size_t BATCH = 256>
+class random_batch {
+public:
+    typedef uint64_t result_type;
+
+    explicit random_batch(uint64_t seed = 0) : engine(seed) {}
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    result_type operator()() {
+        if (next == BATCH) {
+            engine.fill(buffer.data(), BATCH);
+            next = 0;
+        }
+        return buffer[next++];
+    }
+
+private:
+    Engine engine;
+    std::array<uint64_t, BATCH> buffer{};
+    size_t next{BATCH};
+};
+
+// Generator used by the GA operators, swap the engine here to change it everywhere
+typedef random_batch<xoshiro256ss_lanes> ga_rng;
@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ai.h"
+#include "a1_csv.h"
+#include "a1_ga.h"
+
+using namespace std;
+
+// Runs every problem many times with independent recorded seeds and aggregates the runs generation by generation
+//
+// Usage: ga_runs [--runs 100] [--jobs 0] [--problems Onemax,Evolve,Landscape,Evolve2,Allocation] [--seed 0]
+//                [--population 10] [--length 30] [--generations 1000]
+//                [--alloc-population 20] [--alloc-generations 10000]
+//                [--selection roulette|tournament|steady] [--tournament 2] [--offspring 2] [--adaptive 0|1]
+//                [--students Student-choices.csv] [--supervisors Supervisors.csv]
+//                [--output runs.csv] [--seeds runs_seeds.csv] [--replay SEED]
+//
+// --adaptive 1 runs every problem with self-adjusting mutation and crossover rates, see adaptive_rates
+// --jobs runs that many runs at once, 0 uses every core, each run is single threaded
+// --seed 0 picks a master seed at random, it is printed and every run's seed is derived from it,
+// so the whole batch can be repeated from the master seed alone
+// --replay runs each of --problems once with SEED as its run seed, so with the problem and seed from a row of --seeds
+// and the same settings it repeats that one run exactly, it prints the run's --seeds rows and writes no files
+//
+// --output has one row per problem and generation, computed over the runs at that generation:
+// best is each run's best fitness so far, mean is each run's population mean fitness,
+// ci_low and ci_high are the 95% confidence interval of the mean over runs (Student's t)
+// A run that stopped early keeps its last values for the remaining generations
+// --seeds has one row per run with its seed, generations and final best fitness
+
+struct run_job {
+    string problem;
+    size_t run;
+    uint64_t seed;
+    vector<trace_record> history;
+};
+
+const vector<string> splitList(const string& value) {
+    vector<string> values;
+    stringstream ss(value);
+    string token;
+
+    while (getline(ss, token, ',')) {
+        values.push_back(token);
+    }
+
+    return values;
+}
+
+// Two-sided 95% critical value of Student's t for the given degrees of freedom
+double tCritical(size_t df) {
+    static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                   2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                   2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (df == 0) return 0;
+    if (df <= 30) return table[df - 1];
+    if (df <= 60) return 2.000;
+    if (df <= 120) return 1.980;
+    return 1.960;
+}
+
+// Mean, confidence interval and median of values, which are reordered
+void summarise(vector<double>& values, string& out) {
+    const auto n = values.size();
+    double sum{0}, squares{0};
+    for (const auto v : values) sum += v;
+    const auto mean = sum / n;
+    for (const auto v : values) squares += (v - mean) * (v - mean);
+
+    const auto halfWidth = n > 1 ? tCritical(n - 1) * sqrt(squares / (n - 1) / n) : 0.0;
+
+    nth_element(values.begin(), values.begin() + n / 2, values.end());
+    auto median = values[n / 2];
+    if (n % 2 == 0) median = (median + *max_element(values.begin(), values.begin() + n / 2)) / 2;
+
+    out += to_string(mean) + "," + to_string(mean - halfWidth) + "," + to_string(mean + halfWidth) + "," + to_string(median);
+}
+
+int main(int argc, char* argv[]) {
+    map<string, string> options{
+        {"--runs", "100"},
+        {"--jobs", "0"},
+        {"--problems", "Onemax,Evolve,Landscape,Evolve2,Allocation"},
+        {"--seed", "0"},
+        {"--population", "10"},
+        {"--length", "30"},
+        {"--generations", "1000"},
+        {"--alloc-population", "20"},
+        {"--alloc-generations", "10000"},
+        {"--selection", "roulette"},
+        {"--tournament", "2"},
+        {"--offspring", "2"},
+        {"--adaptive", "0"},
+        {"--students", "Student-choices.csv"},
+        {"--supervisors", "Supervisors.csv"},
+        {"--output", "runs.csv"},
+        {"--seeds", "runs_seeds.csv"},
+        {"--replay", "0"},
+    };
+
+    for (auto i = 1; i + 1 < argc; i += 2) {
+        if (options.count(argv[i]) == 0) {
+            cerr << "Unknown option " << argv[i] << endl;
+            return 1;
+        }
+        options[argv[i]] = argv[i + 1];
+    }
+
+    const uint64_t replaySeed = stoull(options["--replay"]);
+    const size_t runs = replaySeed != 0 ? 1 : stoull(options["--runs"]);
+    if (runs == 0) {
+        cerr << "Need at least one run" << endl;
+        return 1;
+    }
+    size_t jobs = stoull(options["--jobs"]);
+    if (jobs == 0) jobs = max(1u, thread::hardware_concurrency());
+    uint64_t masterSeed = stoull(options["--seed"]);
+    if (masterSeed == 0) masterSeed = (uint64_t{random_device{}()} << 32) | random_device{}();
+
+    ga_config config;
+    config.population = stoull(options["--population"]);
+    if (config.population < 2 || config.population % 2 != 0) {
+        cerr << "Population must be even and at least 2" << endl;
+        return 1;
+    }
+    config.length = stoull(options["--length"]);
+    config.generations = stoull(options["--generations"]);
+
+    alloc_config allocConfig;
+    allocConfig.population = stoull(options["--alloc-population"]);
+    allocConfig.generations = stoull(options["--alloc-generations"]);
+
+    // Selection settings apply to every problem
+    try {
+        config.selection = allocConfig.selection = parseSelectionMode(options["--selection"]);
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    config.tournamentSize = allocConfig.tournamentSize = stoull(options["--tournament"]);
+    config.steadyStateOffspring = allocConfig.steadyStateOffspring = stoull(options["--offspring"]);
+    config.adaptive = allocConfig.adaptive = options["--adaptive"] == "1";
+
+    // Every problem the batch can run, each takes a seeded generator and the run's history to fill
+    const map<string, function<void(mt19937_64&, vector<trace_record>&)>> problems{
+        {"Onemax", [&](mt19937_64& mt, vector<trace_record>& history) {
+             auto c = config;
+             c.history = &history;
+             processProblem<problem_a_fitness, problem_a_mutate>(mt, "", c);
+         }},
+        {"Evolve", [&](mt19937_64& mt, vector<trace_record>& history) {
+             auto c = config;
+             c.history = &history;
+             processProblem<problem_b_fitness, problem_a_mutate>(mt, "", c);
+         }},
+        {"Landscape", [&](mt19937_64& mt, vector<trace_record>& history) {
+             auto c = config;
+             c.history = &history;
+             processProblem<problem_c_fitness, problem_a_mutate>(mt, "", c);
+         }},
+        {"Evolve2", [&](mt19937_64& mt, vector<trace_record>& history) {
+             auto c = config;
+             c.history = &history;
+             processProblem<problem_d_fitness, problem_d_mutate>(mt, "", c);
+         }},
+    };
+
+    // The allocation instance is only loaded if it is asked for
+    const auto selected = splitList(options["--problems"]);
+    student_table students;
+    supervisor_table supervisors;
+    preference_matrix preferences;
+    if (find(selected.begin(), selected.end(), "Allocation") != selected.end()) {
+        try {
+            supervisors = parseSupervisorsCsv(options["--supervisors"]);
+            students = parseStudentsCsv(options["--students"], supervisors);
+        } catch (const exception& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        preferences = buildPreferenceMatrix(students, supervisors);
+    }
+
+    vector<run_job> batch;
+    uint64_t seedState = masterSeed;
+    for (const auto& problem : selected) {
+        if (problem != "Allocation" && problems.count(problem) == 0) {
+            cerr << "Unknown problem " << problem << endl;
+            return 1;
+        }
+        for (size_t r = 0; r != runs; r++) {
+            batch.push_back({problem, r, replaySeed != 0 ? replaySeed : splitMix64(seedState), {}});
+        }
+    }
+
+    if (replaySeed != 0) cout << "Replaying " << batch.size() << " run(s) with seed " << replaySeed << "." << endl;
+    else cout << "Running " << batch.size() << " runs on " << jobs << " thread(s), master seed " << masterSeed << "." << endl;
+
+    // Runs are handed out one at a time so long and short problems balance across threads
+    atomic<size_t> nextJob{0};
+    vector<thread> workers;
+    for (size_t w = 0; w != jobs; w++) {
+        workers.emplace_back([&] {
+            for (auto j = nextJob++; j < batch.size(); j = nextJob++) {
+                auto& job = batch[j];
+                mt19937_64 mt(job.seed);
+
+                if (job.problem == "Allocation") {
+                    auto c = allocConfig;
+                    c.history = &job.history;
+                    evolveAllocation(preferences, supervisors, mt, c, "");
+                } else {
+                    problems.at(job.problem)(mt, job.history);
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+
+    string seeds = "problem,run,seed,generations,best_fitness\n";
+    string output = "problem,generation,runs,best_mean,best_ci_low,best_ci_high,best_median,best_max,mean_mean,mean_ci_low,mean_ci_high,mean_median\n";
+    vector<double> best, mean, bestSoFar, lastMean;
+
+    for (const auto& problem : selected) {
+        vector<const run_job*> group;
+        size_t generations{0};
+        for (const auto& job : batch) {
+            if (job.problem != problem) continue;
+            group.push_back(&job);
+            generations = max(generations, job.history.size());
+
+            double runBest{0};
+            for (const auto& r : job.history) runBest = max(runBest, r.max);
+            seeds += problem + "," + to_string(job.run) + "," + to_string(job.seed) + "," + to_string(job.history.size()) + "," +
+                     to_string(static_cast<uint64_t>(runBest)) + "\n";
+        }
+
+        bestSoFar.assign(group.size(), 0);
+        lastMean.assign(group.size(), 0);
+        for (size_t g = 0; g != generations; g++) {
+            for (size_t r = 0; r != group.size(); r++) {
+                const auto& history = group[r]->history;
+                if (g < history.size()) {
+                    bestSoFar[r] = max(bestSoFar[r], history[g].max);
+                    lastMean[r] = history[g].mean;
+                }
+            }
+
+            best = bestSoFar, mean = lastMean;
+            output += problem + "," + to_string(g) + "," + to_string(group.size()) + ",";
+            summarise(best, output);
+            output += "," + to_string(*max_element(bestSoFar.begin(), bestSoFar.end())) + ",";
+            summarise(mean, output);
+            output += "\n";
+        }
+    }
+
+    // A replay only prints its rows, so it never overwrites the batch it came from
+    if (replaySeed != 0) {
+        cout << seeds;
+        return 0;
+    }
+
+    ofstream outputFile(options["--output"]), seedsFile(options["--seeds"]);
+    outputFile.write(output.data(), output.size());
+    seedsFile.write(seeds.data(), seeds.size());
+
+    if (!outputFile || !seedsFile) {
+        cerr << "Failed to write output files" << endl;
+        return 1;
+    }
+
+    return 0;
+}
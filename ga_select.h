@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "ga_random.h"
+
+// Fitness-proportional (roulette wheel) selection shared by both GAs, plus the tournament alternative below
+// Each is built once per generation from fitness values that were already computed,
+// so the fitness function is never called during selection
+
+// Walker's alias method (Vose's construction), O(N) build and O(1) per draw
+class alias_table {
+public:
+    void build(const std::vector<size_t>& fitness) {
+        const auto n = fitness.size();
+        probability.assign(n, 1.0);
+        alias.resize(n);
+        small.clear();
+        large.clear();
+        sum = 0;
+
+        for (const auto f : fitness) sum += f;
+        if (n == 0 || sum == 0) return; // Every column stays at probability 1, draws are uniform
+
+        // Scale so the average column height is 1
+        for (size_t i = 0; i != n; i++) {
+            probability[i] = static_cast<double>(fitness[i]) * n / sum;
+            alias[i] = i;
+            (probability[i] < 1.0 ? small : large).push_back(i);
+        }
+
+        // Top up each short column with the excess of a tall one
+        while (!small.empty() && !large.empty()) {
+            const auto s = small.back(), l = large.back();
+            small.pop_back();
+            alias[s] = l;
+            probability[l] -= 1.0 - probability[s];
+
+            if (probability[l] < 1.0) {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+
+        // Leftovers are 1 up to rounding error
+        for (const auto i : small) probability[i] = 1.0;
+        for (const auto i : large) probability[i] = 1.0;
+    }
+
+    size_t total() const { return sum; }
+    size_t size() const { return probability.size(); }
+
+    // Returns the index of the selected individual, uniform if every fitness is 0
+    template <typename RNG>
+    size_t draw(RNG& rng) const {
+        const auto column = uniformBelow(rng, probability.size());
+        const auto coin = uniformUnit(rng);
+        return coin < probability[column] ? column : alias[column];
+    }
+
+private:
+    std::vector<double> probability;
+    std::vector<size_t> alias, small, large; // small and large are kept to reuse their storage between builds
+    size_t sum{0};
+};
+
+// How each GA picks parents and replaces individuals
+// roulette      fitness proportional, the whole population is replaced every generation
+// tournament    best of k uniform picks, the whole population is replaced every generation
+// steady_state  tournament parents, a few offspring per generation replace the losers of reverse tournaments
+enum class selection_mode { roulette, tournament, steady_state };
+
+// Mode named on a command line as roulette, tournament or steady, throws std::invalid_argument for anything else
+inline selection_mode parseSelectionMode(const std::string& name) {
+    if (name == "roulette") return selection_mode::roulette;
+    if (name == "tournament") return selection_mode::tournament;
+    if (name == "steady") return selection_mode::steady_state;
+    throw std::invalid_argument("Unknown selection " + name);
+}
+
+// Tournament selection, the fittest of size uniformly drawn individuals
+// Needs no fitness sum and no table, so build() only keeps a pointer and each draw costs size lookups,
+// an all-zero population simply ties and stays uniform
+class tournament_selection {
+public:
+    explicit tournament_selection(size_t size = 2) : tournamentSize(size == 0 ? 1 : size) {}
+
+    void build(const std::vector<size_t>& fitness) { this->fitness = &fitness; }
+
+    size_t size() const { return fitness == nullptr ? 0 : fitness->size(); }
+
+    // Returns the index of the winner
+    template <typename RNG>
+    size_t draw(RNG& rng) const {
+        auto winner = uniformBelow(rng, fitness->size());
+        for (size_t i = 1; i != tournamentSize; i++) {
+            const auto challenger = uniformBelow(rng, fitness->size());
+            if ((*fitness)[challenger] > (*fitness)[winner]) winner = challenger;
+        }
+        return winner;
+    }
+
+    // Returns the index of the least fit of size uniformly drawn individuals, used to choose who is replaced
+    template <typename RNG>
+    size_t drawWorst(RNG& rng) const {
+        auto loser = uniformBelow(rng, fitness->size());
+        for (size_t i = 1; i != tournamentSize; i++) {
+            const auto challenger = uniformBelow(rng, fitness->size());
+            if ((*fitness)[challenger] < (*fitness)[loser]) loser = challenger;
+        }
+        return loser;
+    }
+
+private:
+    size_t tournamentSize;
+    const std::vector<size_t>* fitness{nullptr};
+};
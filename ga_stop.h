@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+// When a run may end before its generation limit, zero turns a criterion off
+struct stop_criteria {
+    size_t targetFitness{0}; // Best fitness that counts as solved
+    size_t stallGenerations{0}; // Generations in a row without a new best
+    double seconds{0}; // Wall clock budget, counted across resumes
+};
+
+// Tracks the best fitness of a run against its stop_criteria, one update per generation
+// Its state is two numbers so a checkpoint can carry it over to the resumed run
+class convergence_monitor {
+public:
+    explicit convergence_monitor(const stop_criteria& criteria) : criteria(criteria), start(std::chrono::steady_clock::now()) {}
+
+    // Takes the best fitness found so far, true once any criterion says the run should stop
+    bool converged(size_t bestFitness) {
+        if (!seen || bestFitness > best) {
+            seen = true;
+            best = bestFitness;
+            stall = 0;
+        } else {
+            stall++;
+        }
+
+        return (criteria.targetFitness != 0 && best >= criteria.targetFitness) ||
+               (criteria.stallGenerations != 0 && stall >= criteria.stallGenerations) ||
+               (criteria.seconds > 0 && elapsed() >= criteria.seconds);
+    }
+
+    double elapsed() const {
+        return previous + std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    size_t stalled() const { return stall; }
+
+    // Continues from a checkpointed run that had spent elapsedSeconds and stalled for stalledGenerations
+    void restore(double elapsedSeconds, size_t stalledGenerations, size_t bestFitness) {
+        previous = elapsedSeconds;
+        start = std::chrono::steady_clock::now();
+        stall = stalledGenerations;
+        best = bestFitness;
+        seen = true;
+    }
+
+private:
+    const stop_criteria criteria;
+    std::chrono::steady_clock::time_point start;
+    double previous{0};
+    size_t best{0}, stall{0};
+    bool seen{false};
+};
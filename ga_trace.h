@@ -0,0 +1,189 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class trace_format { text, binary };
+
+// One generation of a run, also the on-disk layout of the binary format
+// A .bin trace is a plain array of these 40 byte records in native byte order, with no header,
+// so it can be memory-mapped directly (numpy: dtype=[('generation','<u8'),('mean','<f8'),('max','<f8'),('min','<f8'),('ns','<u8')])
+struct trace_record {
+    uint64_t generation;
+    double mean, max, min;
+    uint64_t timestamp; // Nanoseconds since the writer was opened
+};
+static_assert(sizeof(trace_record) == 40, "trace_record must stay fixed width");
+
+// Generation trace that never blocks the GA on I/O
+// Records are queued in memory and a background thread writes them out in large blocks,
+// text mode keeps the original "generation mean" line format of Onemax.txt and part_b.txt
+class trace_writer {
+public:
+    static constexpr size_t BLOCK_RECORDS = 4096;
+
+    trace_writer() = default;
+
+    // Opens outputName.txt or outputName.bin, an empty name leaves the writer closed and record() does nothing
+    // A resumed run passes the number of generations it has already done, the existing trace is cut back
+    // to that many records, dropping any written after the checkpoint, and appended to
+    trace_writer(const std::string& outputName, trace_format format, size_t keepRecords = 0) {
+        open(outputName, format, keepRecords);
+    }
+
+    ~trace_writer() { close(); }
+
+    trace_writer(const trace_writer&) = delete;
+    trace_writer& operator=(const trace_writer&) = delete;
+
+    void open(const std::string& outputName, trace_format format, size_t keepRecords = 0) {
+        close();
+        if (outputName.empty()) return;
+
+        this->format = format;
+        const auto filename = outputName + (format == trace_format::binary ? ".bin" : ".txt");
+        const auto resumeAt = keepRecords == 0 ? std::chrono::nanoseconds(0) : truncate(filename, keepRecords);
+        out.open(filename, std::ios::binary | (keepRecords == 0 ? std::ios::trunc : std::ios::app));
+
+        start = std::chrono::steady_clock::now() - resumeAt;
+        pending.reserve(BLOCK_RECORDS);
+        stopping = false;
+        writer = std::thread([this] { writerLoop(); });
+    }
+
+    bool is_open() const { return writer.joinable(); }
+
+    // Also appends every record to into, synchronously and whether or not a file is open
+    // Captured records carry no timestamp, used to collect whole runs in memory
+    void capture(std::vector<trace_record>* into) { captured = into; }
+
+    void record(uint64_t generation, double mean, double max, double min) {
+        if (captured != nullptr) captured->push_back({generation, mean, max, min, 0});
+        if (!is_open()) return;
+
+        const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        bool full;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            pending.push_back({generation, mean, max, min, ns});
+            full = pending.size() >= BLOCK_RECORDS;
+        }
+        if (full) wake.notify_one();
+    }
+
+    // Blocks until everything recorded so far is on disk, used before a checkpoint so a killed run's
+    // trace is never behind the checkpoint it resumes from
+    void flush() {
+        if (!is_open()) return;
+
+        std::unique_lock<std::mutex> lock(m);
+        const auto ticket = ++flushRequests;
+        wake.notify_one();
+        flushed.wait(lock, [this, ticket] { return flushesDone >= ticket; });
+    }
+
+    // Cuts filename back to its first count records, or lines if it is not a .bin trace, returns the timestamp
+    // of the last one kept so a resumed binary trace carries on from the same clock
+    static std::chrono::nanoseconds truncate(const std::string& filename, size_t count) {
+        std::ifstream in(filename, std::ios::binary);
+        if (!in) return std::chrono::nanoseconds(0);
+
+        const std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        size_t keep{0};
+        std::chrono::nanoseconds last(0);
+
+        if (filename.size() > 4 && filename.compare(filename.size() - 4, 4, ".bin") == 0) {
+            keep = std::min(contents.size(), count * sizeof(trace_record)) / sizeof(trace_record) * sizeof(trace_record);
+            if (keep != 0) {
+                trace_record r;
+                contents.copy(reinterpret_cast<char*>(&r), sizeof(r), keep - sizeof(r));
+                last = std::chrono::nanoseconds(r.timestamp);
+            }
+        } else {
+            for (size_t lines = 0; lines != count && keep != contents.size(); lines++) {
+                const auto newline = contents.find('\n', keep);
+                if (newline == std::string::npos) break;
+                keep = newline + 1;
+            }
+        }
+
+        in.close();
+        std::filesystem::resize_file(filename, keep);
+        return last;
+    }
+
+    // Writes everything still queued and stops the writer thread
+    void close() {
+        if (!is_open()) return;
+
+        {
+            std::lock_guard<std::mutex> lock(m);
+            stopping = true;
+        }
+        wake.notify_one();
+        writer.join();
+        out.close();
+    }
+
+private:
+    void writerLoop() {
+        std::vector<trace_record> block;
+        block.reserve(BLOCK_RECORDS);
+        std::string text;
+
+        for (;;) {
+            bool last;
+            uint64_t ticket;
+            {
+                std::unique_lock<std::mutex> lock(m);
+                wake.wait(lock, [this] { return stopping || pending.size() >= BLOCK_RECORDS || flushRequests != flushesDone; });
+                block.swap(pending);
+                last = stopping;
+                ticket = flushRequests;
+            }
+
+            if (format == trace_format::binary) {
+                out.write(reinterpret_cast<const char*>(block.data()), block.size() * sizeof(trace_record));
+            } else {
+                text.clear();
+                for (const auto& r : block) {
+                    text += std::to_string(r.generation);
+                    text += ' ';
+                    text += std::to_string(static_cast<uint64_t>(r.mean));
+                    text += '\n';
+                }
+                out.write(text.data(), text.size());
+            }
+            block.clear();
+
+            if (ticket != flushesDone) {
+                out.flush();
+                {
+                    std::lock_guard<std::mutex> lock(m);
+                    flushesDone = ticket;
+                }
+                flushed.notify_all();
+            }
+
+            if (last) return;
+        }
+    }
+
+    trace_format format{trace_format::text};
+    std::ofstream out;
+    std::thread writer;
+    std::mutex m;
+    std::condition_variable wake, flushed;
+    std::vector<trace_record> pending;
+    std::vector<trace_record>* captured{nullptr};
+    std::chrono::steady_clock::time_point start;
+    uint64_t flushRequests{0}, flushesDone{0};
+    bool stopping{false};
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "bit_genome.h"
+#include "ga_random.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// A genome of 4-bit symbols packed 16 to a word, symbol i lives at bits 4 * (i % 16) of words[i / 16]
+// For small alphabets such as decimal digits, a quarter of the memory of one char per symbol
+// Symbols past length in the last word are always kept at 0
+struct nibble_genome {
+    std::vector<uint64_t> words;
+    size_t length{0};
+
+    nibble_genome() = default;
+    explicit nibble_genome(size_t length) : words((length + 15) / 16, 0), length(length) {}
+
+    size_t size() const { return length; }
+    unsigned get(size_t i) const { return (words[i / 16] >> (4 * (i % 16))) & 0xf; }
+
+    void set(size_t i, unsigned symbol) {
+        const auto shift = 4 * (i % 16);
+        words[i / 16] = (words[i / 16] & ~(uint64_t{0xf} << shift)) | (uint64_t{symbol & 0xf} << shift);
+    }
+
+    void resize(size_t newLength) {
+        length = newLength;
+        words.resize((length + 15) / 16);
+    }
+};
+
+// Number of symbols that differ between word arrays a and b of n words
+// A symbol differs if any of its 4 XOR bits is set, those are folded onto the symbol's low bit and counted,
+// 32 or 16 bytes at a time with AVX2 or SSE2 and a word at a time for the rest
+inline size_t nibbleMismatches(const uint64_t* a, const uint64_t* b, size_t n) {
+    size_t count{0}, i{0};
+
+#if defined(__AVX2__)
+    const auto lowBits = _mm256_set1_epi8(0x11), one = _mm256_set1_epi8(1);
+    auto sums = _mm256_setzero_si256();
+    for (; i + 4 <= n; i += 4) {
+        const auto x = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        auto y = _mm256_or_si256(x, _mm256_srli_epi64(x, 1));
+        y = _mm256_and_si256(_mm256_or_si256(y, _mm256_srli_epi64(y, 2)), lowBits);
+        const auto perByte = _mm256_add_epi8(_mm256_and_si256(y, one), _mm256_and_si256(_mm256_srli_epi64(y, 4), one));
+        sums = _mm256_add_epi64(sums, _mm256_sad_epu8(perByte, _mm256_setzero_si256()));
+    }
+    count += _mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1) + _mm256_extract_epi64(sums, 2) + _mm256_extract_epi64(sums, 3);
+#elif defined(__SSE2__)
+    const auto lowBits = _mm_set1_epi8(0x11), one = _mm_set1_epi8(1);
+    auto sums = _mm_setzero_si128();
+    for (; i + 2 <= n; i += 2) {
+        const auto x = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                                     _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        auto y = _mm_or_si128(x, _mm_srli_epi64(x, 1));
+        y = _mm_and_si128(_mm_or_si128(y, _mm_srli_epi64(y, 2)), lowBits);
+        const auto perByte = _mm_add_epi8(_mm_and_si128(y, one), _mm_and_si128(_mm_srli_epi64(y, 4), one));
+        sums = _mm_add_epi64(sums, _mm_sad_epu8(perByte, _mm_setzero_si128()));
+    }
+    count += _mm_cvtsi128_si64(sums) + _mm_cvtsi128_si64(_mm_unpackhi_epi64(sums, sums));
+#endif
+
+    for (; i != n; i++) {
+        auto y = a[i] ^ b[i];
+        y |= y >> 1;
+        y |= y >> 2;
+        count += popcount64(y & 0x1111111111111111ull);
+    }
+
+    return count;
+}
+
+// Number of positions where g and target hold the same symbol, target must be at least as long as g
+// Padding symbols are 0 in both, so they never count as mismatches
+inline size_t matchCount(const nibble_genome& g, const nibble_genome& target) {
+    return g.length - nibbleMismatches(g.words.data(), target.words.data(), g.words.size());
+}
+
+// Single point crossover, as for bit_genome but split at a symbol boundary
+inline void crossover(const nibble_genome& a, const nibble_genome& b, size_t symbol,
+                      nibble_genome& offspringA, nibble_genome& offspringB) {
+    const auto n = a.words.size();
+    const auto split = symbol / 16;
+    offspringA.resize(a.length);
+    offspringB.resize(a.length);
+
+    for (size_t i = 0; i != split && i != n; i++) {
+        offspringA.words[i] = a.words[i];
+        offspringB.words[i] = b.words[i];
+    }
+
+    if (split < n) {
+        const uint64_t low = (uint64_t{1} << (4 * (symbol % 16))) - 1; // Symbols below the crossover point
+        offspringA.words[split] = (a.words[split] & low) | (b.words[split] & ~low);
+        offspringB.words[split] = (b.words[split] & low) | (a.words[split] & ~low);
+    }
+
+    for (size_t i = split + 1; i < n; i++) {
+        offspringA.words[i] = b.words[i];
+        offspringB.words[i] = a.words[i];
+    }
+}
+
+// Fills the genome with uniformly random digits 0-9
+template <typename RNG>
+void randomize(nibble_genome& g, RNG& rng) {
+    for (size_t i = 0; i != g.length; i++) {
+        g.set(i, uniformBelow(rng, 10));
+    }
+}
+
+// Repeats a string of digits until length symbols are filled, used to stretch fixed targets to longer genomes
+inline nibble_genome tiledNibbleGenome(const std::string& digits, size_t length) {
+    nibble_genome g(length);
+    for (size_t i = 0; i != length; i++) {
+        g.set(i, digits[i % digits.length()] - '0');
+    }
+    return g;
+}